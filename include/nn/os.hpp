@@ -145,6 +145,7 @@ namespace os {
                         s32 coreNum);
     void DestroyThread(nn::os::ThreadType*);
     void StartThread(nn::os::ThreadType*);
+    void WaitThread(nn::os::ThreadType*);
     void SetThreadName(nn::os::ThreadType*, char const* threadName);
     void SetThreadNamePointer(nn::os::ThreadType*, char const*);
     char* GetThreadNamePointer(nn::os::ThreadType const*);
@@ -156,6 +157,17 @@ namespace os {
     void ResumeThread(nn::os::ThreadType*);
     void SleepThread(nn::TimeSpan);
 
+    // THREAD LOCAL STORAGE
+    struct TlsSlot {
+        u32 _innerValue;
+    };
+    typedef void (*TlsDestructor)(uintptr_t);
+
+    Result AllocateTlsSlot(TlsSlot*, TlsDestructor);
+    void FreeTlsSlot(TlsSlot);
+    uintptr_t GetTlsValue(TlsSlot);
+    void SetTlsValue(TlsSlot, uintptr_t);
+
     // EVENTS
     void InitializeEvent(EventType*, bool initiallySignaled, EventClearMode clearMode);
     void FinalizeEvent(EventType*);
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "skyline/inlinehook/And64InlineHook.hpp"
+
+namespace skyline::hook {
+
+namespace detail {
+
+// everything about a hook that doesn't depend on how the target is declared. Function is the target's exact type,
+// which the original is called through, and Replacement what a replacement has to convert to
+template <auto Target, typename Function, typename Replacement>
+class HookBase {
+   public:
+    // hooks the target, see A64HookFunctionPriority. a hooked target is not hooked again
+    template <typename Replace>
+    static HookHandle install(Replace replace, s32 priority = 0) {
+        // checked here rather than left to the conversion, which -fpermissive lets through with a warning
+        static_assert(std::is_convertible_v<Replace, Replacement>, "replacement does not match the hooked function");
+        if (s_Handle == 0)
+            s_Handle = A64HookFunctionPriority(reinterpret_cast<void*>(Target),
+                                               reinterpret_cast<void*>(static_cast<Replacement>(replace)),
+                                               reinterpret_cast<void**>(&s_Original), priority);
+        return s_Handle;
+    }
+
+    // the same hook as an entry of A64HookFunctionBatch
+    template <typename Replace>
+    static HookSpec spec(Replace replace, s32 priority = 0) {
+        static_assert(std::is_convertible_v<Replace, Replacement>, "replacement does not match the hooked function");
+        return {reinterpret_cast<void*>(Target), reinterpret_cast<void*>(static_cast<Replacement>(replace)),
+                reinterpret_cast<void**>(&s_Original), priority, &s_Handle};
+    }
+
+    // calls the next hook in the chain, or the original function. a single indirect call once inlined
+    template <typename... CallArgs>
+    static inline decltype(auto) original(CallArgs&&... args) noexcept(
+        noexcept(std::declval<Function>()(std::forward<CallArgs>(args)...))) {
+        return s_Original(std::forward<CallArgs>(args)...);
+    }
+
+    static Result remove() {
+        Result rc = A64HookRemove(s_Handle);
+        if (R_SUCCEEDED(rc)) s_Handle = 0;
+        return rc;
+    }
+
+    static bool installed() { return s_Handle != 0; }
+    static HookHandle handle() { return s_Handle; }
+
+   private:
+    static inline Function s_Original = nullptr;
+    static inline HookHandle s_Handle = 0;
+};
+
+// what a replacement for a target of type Function has to convert to: the same function, whether noexcept or not.
+// void for anything that isn't a pointer to a function. the target's type is matched here rather than the target
+// itself in Hook's specializations, GCC finds those ambiguous for the noexcept and C variadic forms
+template <typename Function>
+struct ReplacementOf {
+    using type = void;
+};
+
+template <typename R, typename... Args>
+struct ReplacementOf<R (*)(Args...)> {
+    using type = R (*)(Args...);
+};
+
+template <typename R, typename... Args>
+struct ReplacementOf<R (*)(Args...) noexcept> {
+    using type = R (*)(Args...);
+};
+
+template <typename R, typename... Args>
+struct ReplacementOf<R (*)(Args..., ...)> {
+    using type = R (*)(Args..., ...);
+};
+
+template <typename R, typename... Args>
+struct ReplacementOf<R (*)(Args..., ...) noexcept> {
+    using type = R (*)(Args..., ...);
+};
+
+}  // namespace detail
+
+// Typed wrapper around A64HookFunction for one hooked function, which also owns the pointer to the original:
+//
+//     Result handleMountRom(const char* name, void* buffer, ulong size) {
+//         return Hook<&nn::fs::MountRom>::original(name, buffer, size);
+//     }
+//     Hook<&nn::fs::MountRom>::install(handleMountRom);
+//
+// Replacements with a different signature than the target fail to compile. Overloaded targets have to be picked with
+// a static_cast to the wanted function pointer type. A noexcept target takes replacements with or without noexcept,
+// only the original keeps it; a C variadic target takes variadic replacements of the same parameters
+template <auto Target>
+class Hook
+    : public detail::HookBase<Target, decltype(Target), typename detail::ReplacementOf<decltype(Target)>::type> {
+    static_assert(!std::is_void_v<typename detail::ReplacementOf<decltype(Target)>::type>,
+                  "Hook target must be a pointer to a non-member function");
+
+   public:
+    using Function = decltype(Target);
+};
+
+}  // namespace skyline::hook
@@ -27,7 +27,6 @@
  SOFTWARE.
  */
 #pragma once
-#define A64_MAX_BACKUPS 256 * 2
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,15 +44,150 @@ long long int llabs(long long int n);
 }
 #endif
 
+#include <initializer_list>
+
 #include "controlledpages.hpp"
 #include "skyline/logger/Logger.hpp"
 
+// identifies an installed hook, 0 if installing it failed
+typedef u64 HookHandle;
+
 struct InlineCtx {
     nn::os::CpuRegister registers[29];
 };
 
+// context passed to callbacks hooked with A64_INLINE_REGS_FPU
+struct InlineFpCtx : InlineCtx {
+    nn::os::CpuRegister fp;
+    nn::os::CpuRegister lr;
+    u64 nzcv;
+    nn::os::FpuRegister fpu_registers[32];
+};
+
+// registers an inline hook callback reads or writes through its context, for A64InlineHookEx
+#define A64_INLINE_REG(n) (1ull << (n))
+#define A64_INLINE_REGS_CALLER_SAVED 0x7ffffull  // x0-x18, the cheapest handler only saves these
+#define A64_INLINE_REGS_ALL 0x1fffffffull        // x0-x28
+#define A64_INLINE_REGS_FPU (1ull << 32)         // q0-q31 as well, the callback receives an InlineFpCtx
+
+// a register rewrite compiled directly into an inline patch, see A64InlinePatch
+struct InlinePatchOp {
+    enum Type : u32 { Set, Copy, Add, Clamp } type;
+    u32 reg;    // x0-x30, except x16-x18
+    u64 value;  // immediate for Set/Add, source register for Copy, signed minimum for Clamp
+    u64 max;    // signed maximum for Clamp
+
+    static constexpr InlinePatchOp SetReg(u32 reg, u64 value) { return {Set, reg, value, 0}; }
+    static constexpr InlinePatchOp CopyReg(u32 reg, u32 source) { return {Copy, reg, source, 0}; }
+    static constexpr InlinePatchOp AddReg(u32 reg, s64 addend) { return {Add, reg, static_cast<u64>(addend), 0}; }
+    static constexpr InlinePatchOp ClampReg(u32 reg, s64 min, s64 max) {
+        return {Clamp, reg, static_cast<u64>(min), static_cast<u64>(max)};
+    }
+};
+
+struct HookSpec {
+    void* symbol;
+    void* replace;
+    void** result;
+    s32 priority;        // see A64HookFunctionPriority, 0 when left out
+    HookHandle* handle;  // receives the hook's handle if set
+};
+
+// filled in by the probes installed with A64TimeHook, in system ticks
+struct HookTimeStats {
+    u64 calls;
+    u64 total_ticks;
+    u64 min_ticks;
+    u64 max_ticks;
+};
+
+// a hook's entry in the stats table, see A64HookSetStatsEnabled
+struct HookStats {
+    HookHandle handle;
+    void* symbol;
+    HookTimeStats time;  // time spent in the replacement itself, calls it passes on are left out
+};
+
+// time spent installing hooks, in system ticks. the phases are part of the total and overlap nothing else, but also
+// count work done outside of the hook API, such as sky_memcpy's claims
+struct HookInstallStats {
+    u64 hooks;
+    u64 total_ticks;
+    u64 claim_ticks;     // mapping and unmapping rw aliases of code
+    u64 relocate_ticks;  // relocating overwritten instructions into trampolines
+    u64 jit_ticks;       // creating trampoline regions and switching them between rw and rx
+    u64 cache_ticks;     // data and instruction cache maintenance
+};
+
 void A64HookInit();
-extern "C" void A64HookFunction(void* const symbol, void* const replace, void** result);
+extern "C" HookHandle A64HookFunction(void* const symbol, void* const replace, void** result);
+/// Hooks a symbol that may already be hooked. Hooks with a higher priority run first, result receives the next hook
+/// in the chain (or the original function) and is kept up to date as hooks are added
+extern "C" HookHandle A64HookFunctionPriority(void* const symbol, void* const replace, void** result, s32 priority);
+/// Installs several hooks at once, claiming each affected code page and transitioning the JIT only once
+extern "C" void A64HookFunctionBatch(const HookSpec* specs, size_t count);
+/// Installs a batch under handles taken from A64HookReserveHandle, for hooks that were handed out before installing
+void A64HookFunctionBatchReserved(const HookSpec* specs, const HookHandle* handles, size_t count);
+/// Takes a handle for a hook that will only be installed later
+HookHandle A64HookReserveHandle();
+/// Queues a hook on a symbol that may not be loaded yet. Queued hooks are installed in one batch once their symbol
+/// resolves: after every nn::ro module load, after the plugins' main functions ran, or on A64HookResolveDeferred.
+/// The returned handle refers to the hook from the start, a hook disabled or removed while it is queued is not
+/// installed
+extern "C" HookHandle A64HookFunctionDeferred(const char* symbol_name, void* const replace, void** result);
+/// Installs the queued hooks whose symbol resolves now, returning how many were installed
+extern "C" size_t A64HookResolveDeferred();
 void* A64HookFunctionV(void* const symbol, void* const replace, void* const rxtr, void* const rwtr,
                        const uintptr_t rwx_size);
-extern "C" void A64InlineHook(void* const symbol, void* const replace);
+extern "C" HookHandle A64InlineHook(void* const symbol, void* const replace);
+/// Inline hook whose handler only saves the registers in reg_mask (see A64_INLINE_REGS_*), the others are not valid in
+/// the context. Caller-saved registers, FP/SIMD ones (q0-q7, q16-q31) included, and the condition flags are always
+/// preserved
+extern "C" HookHandle A64InlineHookEx(void* const symbol, void* const replace, u64 reg_mask);
+/// Runs ops at symbol without a callback, they are compiled in front of the relocated instructions. The condition
+/// flags are preserved, x16 and x17 are not. handle receives the patch's handle if set, which is disabled and
+/// removed like any other hook
+extern "C" Result A64InlinePatch(void* const symbol, const InlinePatchOp* ops, size_t count,
+                                 HookHandle* handle = NULL);
+inline Result A64InlinePatch(void* const symbol, std::initializer_list<InlinePatchOp> ops,
+                             HookHandle* handle = NULL) {
+    return A64InlinePatch(symbol, ops.begin(), ops.size(), handle);
+}
+/// Atomically increments counter every time symbol is executed, without leaving the JIT
+extern "C" Result A64CountHook(void* const symbol, u64* counter, HookHandle* handle = NULL);
+/// Times every call to symbol into stats. The return address is redirected through a probe, so symbol must be the
+/// entry of a function that returns normally (no longjmp out of it)
+extern "C" Result A64TimeHook(void* const symbol, HookTimeStats* stats, HookHandle* handle = NULL);
+/// Records the start and end of every call to symbol into a per-thread ring, which is streamed to the logger in the
+/// background. name labels the calls in the converted trace, see scripts/convertTrace.py. Same restrictions as
+/// A64TimeHook
+extern "C" Result A64TraceHook(void* const symbol, const char* name, HookHandle* handle = NULL);
+/// Takes a hook out of its symbol's chain until it is enabled again. Once no hook on a symbol is enabled, its original
+/// instructions are restored. Patches and probes stay in front of the hooks chained on their symbol
+extern "C" Result A64HookDisable(HookHandle handle);
+extern "C" Result A64HookEnable(HookHandle handle);
+/// Uninstalls a hook for good, its trampoline is reused by later hooks. Nothing may still be executing inside the hook
+/// when it is removed, except for an inline hook callback, whose entry is only reused a second later
+extern "C" Result A64HookRemove(HookHandle handle);
+/// Hooks installed through A64HookFunction and A64InlineHook while stats are enabled count their calls and time their
+/// replacement or callback. Hooks installed before are not affected
+extern "C" void A64HookSetStatsEnabled(bool enabled);
+/// Copies up to count entries of the stats table in handle order, returning how many were written
+extern "C" size_t A64HookGetStats(HookStats* stats, size_t count);
+/// Logs the stats of every timed hook
+extern "C" void A64HookDumpStats();
+/// Logs the calls counted by every A64CountHook probe and the times of every A64TimeHook probe that wasn't removed
+extern "C" void A64HookDumpProbes();
+/// Starts a thread logging the stats and the probes every interval_ms, once
+extern "C" void A64HookStartStatsDump(u64 interval_ms);
+/// Reads the install time of every hook since the last reset
+extern "C" void A64HookGetInstallStats(HookInstallStats* stats);
+extern "C" void A64HookResetInstallStats();
+/// Logs the install time per hook, broken down by phase
+extern "C" void A64HookDumpInstallStats();
+/// Measures the cost of a call through each hooking mechanism on synthetic functions, hooked on the first run, and
+/// logs them next to a direct call
+extern "C" Result A64HookBenchmark(u32 iterations);
+/// Hooks count synthetic functions one by one and then as a batch, logging the install time per hook by phase and
+/// the time it takes to remove them again. Every hook is removed once measured
+extern "C" Result A64HookInstallBenchmark(u32 count);
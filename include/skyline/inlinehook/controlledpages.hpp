@@ -6,6 +6,7 @@ namespace skyline::inlinehook {
 class ControlledPages {
    private:
     bool isClaimed;
+    bool isCached;
     size_t size;
 
    public:
@@ -17,4 +18,21 @@ class ControlledPages {
     void claim();
     void unclaim();
 };
-};  // namespace skyline::inlinehook
\ No newline at end of file
+
+// Keeps RW aliases of the main module's .text mapped between claims, so repeated patches skip the SVC round trips
+class PageAliasCache {
+   public:
+    // maps (or reuses) an alias covering [rx, rx + size), returns false if the range can't be served from the cache
+    static bool acquire(u64 rx, size_t size, u64* out_rw);
+    static void release(u64 rx);
+    // unmaps every alias that isn't currently claimed, returns the amount of bytes unmapped
+    static size_t trim();
+};
+// finds unmapped, page-aligned space of the given size entirely within range bytes of near
+Result locateMappableSpaceNear(uintptr_t* out_address, size_t size, uintptr_t near, size_t range);
+// maps an rw alias of the page-aligned code at rx that stays mapped for good, so code other threads may be running
+// can be written without ever being unmapped
+Result mapPersistentAlias(uintptr_t rx, size_t size, uintptr_t* out_rw);
+};  // namespace skyline::inlinehook
+
+extern "C" size_t sky_trim_page_aliases();
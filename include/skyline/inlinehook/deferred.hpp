@@ -0,0 +1,24 @@
+#pragma once
+
+#include "skyline/inlinehook/And64InlineHook.hpp"
+#include "types.h"
+
+namespace skyline::inlinehook {
+
+// Hooks queued by A64HookFunctionDeferred until their symbol can be resolved. Symbols are looked up in the symbol
+// tables of every loaded module through nn::ro, then in the symbol map
+class DeferredHooks {
+   public:
+    // hooks nn::ro::LoadModule and UnloadModule, so each module load installs the hooks waiting on it. also keeps
+    // the module indices of SymbolMap::symbolize in step with the loaded modules
+    static void trackModules();
+    // installs every queued hook whose symbol resolves now in a single batch, returning how many were installed
+    static size_t resolve();
+    // marks a queued hook, returning false if handle isn't queued. disabled hooks stay queued when their symbol
+    // resolves, enabling one installs it right away if it can be
+    static bool setEnabled(HookHandle handle, bool enabled);
+    // drops a queued hook, returning false if handle isn't queued
+    static bool cancel(HookHandle handle);
+};
+
+};  // namespace skyline::inlinehook
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/counter.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace skyline::inlinehook {
+
+// where installing a hook spends its time
+enum InstallPhase {
+    InstallPhase_Claim,     // mapping and unmapping rw aliases of code
+    InstallPhase_Relocate,  // relocating the overwritten instructions
+    InstallPhase_Jit,       // creating trampoline regions and switching them between rw and rx
+    InstallPhase_Cache,     // data and instruction cache maintenance
+    InstallPhase_Total,     // the whole install call
+    InstallPhase_Count,
+};
+
+// Tick counters of every hook installed since the last reset, updated by the install paths themselves. Phases nest
+// inside the total and may run on several threads at once, so they are kept with relaxed atomics
+class InstallStats {
+   public:
+    static void add(InstallPhase phase, u64 ticks);
+    static void addHooks(u64 count);
+
+    static u64 ticks(InstallPhase phase);
+    static u64 hooks();
+    static void reset();
+};
+
+// adds the ticks between its construction and destruction to a phase
+class InstallTimer {
+   public:
+    explicit InstallTimer(InstallPhase phase) : m_phase(phase), m_start(armGetSystemTick()) {}
+    ~InstallTimer() { InstallStats::add(m_phase, armGetSystemTick() - m_start); }
+
+    InstallTimer(const InstallTimer&) = delete;
+    InstallTimer& operator=(const InstallTimer&) = delete;
+
+   private:
+    InstallPhase m_phase;
+    u64 m_start;
+};
+
+};  // namespace skyline::inlinehook
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "types.h"
+
+namespace skyline::inlinehook {
+
+// set on the stats pointer of a probe block to leave out the time spent in nested timed calls
+#define TIME_PROBE_EXCLUSIVE 1ull
+// marks a probe block that traces its calls instead, its stats word holds the hook id above TIME_PROBE_TRACE_SHIFT
+#define TIME_PROBE_TRACE 2ull
+#define TIME_PROBE_TRACE_SHIFT 8
+
+// Per-thread bookkeeping behind the probes emitted by A64TimeHook. The entry probe pushes the caller's return address
+// and a start tick onto a shadow stack, the exit probe pops them and records the elapsed ticks
+class TimeProbes {
+   public:
+    // allocates the TLS slot holding each thread's shadow stack, must be called before the first probe is installed
+    static Result initialize();
+};
+
+};  // namespace skyline::inlinehook
+
+// called by timeProbeEnter/timeProbeExit in armutils.s
+extern "C" uintptr_t skyline_time_probe_enter(const void* block, uintptr_t lr);
+extern "C" uintptr_t skyline_time_probe_exit();
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define A64_MAX_INSTRUCTIONS 5
+#define A64_MAX_REFERENCES (A64_MAX_INSTRUCTIONS * 2)
+#define A64_NOP 0xd503201fu
+
+namespace skyline::inlinehook {
+
+// Relocates count instructions, read through inprw and located at inprx, to outrwp, which executes at outrxp.
+// PC-relative instructions are rewritten for their new address and a branch back to inprx + count is appended.
+// Only transforms buffers, so it builds on any host and leaves cache maintenance to the caller. Returns the number of
+// bytes written, at most count * 10 instructions, or 0 if count is out of range
+uintptr_t relocateInstructions(uint32_t* __restrict inprw, uint32_t* __restrict inprx, int32_t count,
+                               uint32_t* __restrict outrwp, uint32_t* __restrict outrxp);
+
+enum class RelocationHazard {
+    None,
+    FunctionEnd,       // the window returns or branches away before its last instruction
+    BranchIntoWindow,  // code around the window branches past its first instruction
+};
+
+// Checks whether the count instructions at window can be overwritten by a patch. Instructions in [scan_begin,
+// scan_end) are searched for branches and ADRs into the window, the range must be readable
+RelocationHazard findRelocationHazard(const uint32_t* window, int32_t count, const uint32_t* scan_begin,
+                                      const uint32_t* scan_end);
+
+};  // namespace skyline::inlinehook
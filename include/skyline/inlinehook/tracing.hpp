@@ -0,0 +1,54 @@
+#pragma once
+
+#include "types.h"
+
+namespace skyline::inlinehook {
+
+#define TRACE_RING_SIZE 0x1000  // records, must be a power of two
+#define TRACE_RING_COUNT 32     // threads that can trace at once, later ones are not traced
+#define TRACE_MAX_HOOKS 0x400
+#define TRACE_RECORD_EXIT 0x80000000u
+#define TRACE_RECORD_FRAME 0x7fffffffu  // id of a frame boundary, see skyline::profile::frame
+
+struct TraceRecord {
+    u64 tick;
+    u32 id;  // hook id, TRACE_RECORD_EXIT is set for the end of a call
+    u32 thread;
+};
+
+// written only by the thread it is claimed by, read only by the drain thread
+struct TraceRing {
+    u64 head;
+    u64 tail;
+    u64 dropped;  // records lost to a full ring since the last drain
+    u32 thread;
+    bool claimed;
+    TraceRecord records[TRACE_RING_SIZE];
+};
+
+// The rings behind A64TraceHook and skyline::profile, which the drain thread periodically sends to the logger as
+// binary frames, see scripts/convertTrace.py for the layout
+class TraceRings {
+   public:
+    // allocates the rings and starts the drain thread, once
+    static Result initialize();
+    // names the next id
+    static Result registerName(const char* name, u32* id);
+
+    // the calling thread's ring, claimed on first use. NULL before initialize or once all rings are taken, neither
+    // this nor push locks or allocates
+    static TraceRing* current();
+
+    static inline void push(TraceRing* ring, u64 tick, u32 id) {
+        u64 head = ring->head;
+        if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == TRACE_RING_SIZE) {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        ring->records[head & (TRACE_RING_SIZE - 1)] = {tick, id, ring->thread};
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+};
+
+};  // namespace skyline::inlinehook
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/kernel/jit.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace skyline::inlinehook {
+
+struct Trampoline {
+    uint32_t* rx;
+    uint32_t* rw;
+    size_t size;  // in bytes
+};
+
+// Hands out variable-sized chunks of JIT memory for trampolines, chaining new regions as they fill up.
+// Not thread-safe, callers are expected to hold the hook mutex.
+// Every call into a hooked function may run through a region, so a region that was made executable once is never
+// unmapped again: it is written through a persistent rw alias instead. Should that alias fail to map, the region is
+// sealed and only newer regions are written to.
+class TrampolinePool {
+   public:
+    static constexpr size_t REGION_SIZE = 0x10000;
+    static constexpr size_t ALIGNMENT = 8;  // literal pools inside trampolines need 8-byte alignment
+    static constexpr size_t BRANCH_RANGE = 0x8000000;  // reach of B/BL, +-128 MiB
+
+    // reserves up to size bytes, which can be written through out->rw until the next flush().
+    // if near is given, the whole reservation is guaranteed to be reachable from near with a single B/BL
+    static Result reserve(size_t size, Trampoline* out, uintptr_t near = 0);
+    // gives back the unused tail of a reservation
+    static void commit(Trampoline* trampoline, size_t used);
+    // returns a whole reservation to the pool. nothing may still be executing it
+    static void release(Trampoline* trampoline);
+    // overwrites part of a previously reserved trampoline, given its rx address. an aligned 8-byte write is a
+    // single store, so a literal can be swapped while the code loading it runs. fails for a sealed region
+    static Result write(void* rx, const void* data, size_t size);
+    // performs cache maintenance on everything written since the last flush and makes it executable again
+    static Result flush();
+};
+
+};  // namespace skyline::inlinehook
@@ -17,6 +17,9 @@ class Logger {
     virtual void SendRaw(void*, size_t) = 0;
     virtual std::string FriendlyName() = 0;
     virtual bool ShouldFlush() = 0;
+    // changes every time the logger (re)connects to its reader, 0 while there is none. loggers without a connection
+    // always have the same reader
+    virtual u32 ConnectionId() { return 1; }
 
 #ifndef NOLOG
     void StartThread();
@@ -25,6 +28,8 @@ class Logger {
     void LogFormat(const char* format, ...);
     void SendRaw(const char*);
     void SendRawFormat(const char*, ...);
+    // sends binary data right away, between two queued messages rather than in the middle of one
+    void SendFrame(const void* data, size_t size);
     void Flush();
 #else
     inline void StartThread() {}
@@ -33,6 +38,7 @@ class Logger {
     inline void LogFormat(const char* format, ...) {}
     inline void SendRaw(const char*) {}
     inline void SendRawFormat(const char*, ...) {}
+    inline void SendFrame(const void* data, size_t size) {}
     inline void Flush() {}
 #endif
 };
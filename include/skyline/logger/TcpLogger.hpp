@@ -16,6 +16,7 @@ class TcpLogger : public Logger {
    public:
     virtual void Initialize();
     virtual bool ShouldFlush() override;
+    virtual u32 ConnectionId() override;
     virtual void SendRaw(void*, size_t);
     virtual std::string FriendlyName() { return "TcpLogger"; }
 };
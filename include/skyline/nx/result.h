@@ -185,4 +185,12 @@ enum {
     SkylineError_InvalidPluginName,
     SkylineError_InlineHookHandlerSizeInvalid,
     SkylineError_InlineHookPoolExhausted,
+    SkylineError_TrampolineTooLarge,
+    SkylineError_InlinePatchInvalid,
+    SkylineError_InvalidHookHandle,
+    SkylineError_UnsafeHookTarget,
+    SkylineError_InvalidProfilerRate,
+    SkylineError_TraceRingsUnavailable,
+    SkylineError_InvalidBenchmarkIterations,
+    SkylineError_TrampolineSealed,
 };
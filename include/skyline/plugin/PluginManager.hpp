@@ -54,6 +54,7 @@ namespace plugin {
         static inline void LoadPlugins() { GetInstance().LoadPluginsImpl(); }
         static inline bool LoadPluginModules() { return GetInstance().LoadPluginModulesImpl(); }
         static inline const PluginInfo* GetContainingPlugin(const void* addr) { return GetInstance().GetContainingPluginImpl(addr); }
+        static inline const std::vector<PluginInfo>& GetPlugins() { return GetInstance().m_pluginInfos; }
     };
 
 };  // namespace plugin
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "types.h"
+
+// Cheap profiling zones and frame marks for plugins. Stamps go into the calling thread's trace ring, and are streamed
+// over the logger together with A64TraceHook's records, see scripts/convertTrace.py. Until skyline_profile_start is
+// called, zones only cost a check.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Starts recording zones, and the thread streaming them to the logger
+Result skyline_profile_start();
+/// Returns the id zones named name are recorded under, ~0 if no more zones can be named
+u32 skyline_profile_register_zone(const char* name);
+void skyline_profile_begin(u32 zone);
+void skyline_profile_end(u32 zone);
+/// Marks the end of a frame
+void skyline_profile_frame();
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+namespace skyline::profile {
+
+static constexpr u32 INVALID_ZONE = ~0u;
+
+// records a zone for the scope it lives in
+class Zone {
+   public:
+    inline explicit Zone(u32 id) : m_id(id) { skyline_profile_begin(m_id); }
+    inline ~Zone() { skyline_profile_end(m_id); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+   private:
+    u32 m_id;
+};
+
+inline void frame() { skyline_profile_frame(); }
+
+};  // namespace skyline::profile
+
+#define SKYLINE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SKYLINE_PROFILE_CONCAT(a, b) SKYLINE_PROFILE_CONCAT_IMPL(a, b)
+
+// profiles the rest of the enclosing scope as name, which is only looked at the first time through
+#define SKYLINE_PROFILE_ZONE(name)                                                                               \
+    static const u32 SKYLINE_PROFILE_CONCAT(__skyline_zone_id_, __LINE__) = skyline_profile_register_zone(name); \
+    skyline::profile::Zone SKYLINE_PROFILE_CONCAT(__skyline_zone_, __LINE__)(                                    \
+        SKYLINE_PROFILE_CONCAT(__skyline_zone_id_, __LINE__))
+
+// profiles the rest of the enclosing scope under the name of the enclosing function
+#define SKYLINE_PROFILE_FUNCTION() SKYLINE_PROFILE_ZONE(__func__)
+
+#define SKYLINE_PROFILE_FRAME() skyline::profile::frame()
+
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace skyline::utils {
+
+// registers a stack walk starts from, and the bounds of the stack it walks
+struct SampledContext {
+    uintptr_t pc;
+    uintptr_t lr;
+    uintptr_t fp;
+    uintptr_t sp;
+    uintptr_t stack_end;
+};
+
+struct SampledModule {
+    std::string name;
+    uintptr_t start;
+    uintptr_t end;
+};
+
+// where samples come from: the kernel's thread contexts on console, or a stand-in when the sampler runs elsewhere
+class ThreadContextSource {
+   public:
+    virtual ~ThreadContextSource() = default;
+
+    // fills ids with up to max threads to sample, returning how many were written
+    virtual size_t listThreads(u64* ids, size_t max) = 0;
+    virtual std::string threadName(u64 id) = 0;
+    // stops the thread and reads its registers. every successful suspend is followed by a resume, and nothing in
+    // between may allocate, as the suspended thread could be holding the heap lock
+    virtual bool suspend(u64 id, SampledContext* context) = 0;
+    virtual void resume(u64 id) = 0;
+    // reads a word from a suspended thread's stack, failing for anything outside of it
+    virtual bool readStack(u64 id, uintptr_t address, u64* value) = 0;
+};
+
+// Statistical profiler core: walks the frame pointer chain of every thread a source offers, and aggregates the
+// stacks into per-thread folded stacks and per-module sample counts. Not thread-safe.
+// Code built without frame pointers (-fomit-frame-pointer) is free to use x29 for anything. Frames of such code are
+// missing from the stacks, and the walk stops at the first x29 that doesn't point between sp and the end of the stack
+// rather than following whatever it holds.
+class Sampler {
+   public:
+    static constexpr size_t MAX_THREADS = 0x80;
+    static constexpr size_t MAX_FRAMES = 32;
+
+    // names address, which lies in module, returning false to fall back to module+offset
+    using Symbolizer = std::function<bool(uintptr_t address, const SampledModule& module, std::string* out)>;
+
+    Sampler(ThreadContextSource* source, Symbolizer symbolizer);
+
+    void setModules(std::vector<SampledModule> modules);
+    // samples every thread once
+    void sample();
+    // emits everything gathered since the last report and starts over. each thread gets a summary line starting with
+    // '#', followed by its stacks as "thread;root;...;leaf count"
+    void report(const std::function<void(const std::string& line)>& emit);
+
+   private:
+    struct ThreadProfile {
+        std::string name;
+        u64 samples;
+        std::map<size_t, u64> modules;                  // module index to samples with their leaf in it
+        std::map<std::vector<uintptr_t>, u64> stacks;  // leaf first
+    };
+
+    ThreadContextSource* m_source;
+    Symbolizer m_symbolizer;
+    std::vector<SampledModule> m_modules;  // sorted by start
+    std::map<u64, ThreadProfile> m_threads;
+
+    size_t walk(u64 id, const SampledContext& context, uintptr_t* frames);
+    size_t findModule(uintptr_t address) const;
+    std::string frameName(uintptr_t address);
+};
+
+};  // namespace skyline::utils
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "types.h"
+
+namespace skyline::utils::SamplingProfiler {
+
+// records threads as they are started from now on, so the game's threads are known by the time a profile is taken.
+// the thread calling this is recorded too. only the first call hooks anything, start calls it as well, so plugins that
+// profile threads started at boot call it from their main
+void trackThreads();
+// samples every tracked thread rateHz times a second, streaming folded stacks over the logger every reportIntervalMs
+Result start(u32 rateHz, u32 reportIntervalMs);
+void stop();
+
+}  // namespace skyline::utils::SamplingProfiler
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void skyline_profiler_track_threads();
+Result skyline_profiler_start(u32 rate_hz, u32 report_interval_ms);
+void skyline_profiler_stop();
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,10 +2,32 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace skyline::utils::SymbolMap {
 
+// reads the map files in the background and merges them once all are read. returns false if there are none
+bool startLoad();
+// blocks until a load started by startLoad is done, lookups do so themselves
+void waitLoaded();
+// startLoad and waitLoaded, returning whether any symbols were loaded
 bool tryLoad();
-uintptr_t getSymbolAddress(std::string name);
+// returns 0 for names no map has, without allocating
+uintptr_t getSymbolAddress(std::string_view name);
+uintptr_t getSymbolAddress(const char* name);
+// indexes the exported functions of every loaded module for symbolize, again on every call to catch new modules
+void indexModules();
+// drops the index of the module whose .text starts at base. done before the module is unloaded, the index points
+// into its string table
+void dropModule(uintptr_t base);
+// finds the symbol containing address, along with how far into it address is. covers the symbol maps and the modules
+// indexed by indexModules
+bool symbolize(uintptr_t address, std::string* name, uintptr_t* offset);
+// the same without allocating, name points into a map, which stays loaded for good, or into a module's string table,
+// which is only valid while that module stays loaded
+bool symbolize(uintptr_t address, const char** name, uintptr_t* offset);
+// the same without blocking, for exception handlers: fails rather than wait for the indices, which the crashed thread
+// may hold
+bool trySymbolize(uintptr_t address, const char** name, uintptr_t* offset);
 
 }
@@ -1,60 +1,302 @@
 # Create a binary symbol map file from an IDA/Ghidra exported .map file
+#
+# v3 maps (the default) are looked up in place by skyline, all fields are little endian u32:
+#   header:        magic "SKSM", version 3, symbol count, bucket count (a power of two),
+#                  symbols offset, displacements offset, strings offset, strings size
+#   symbols:       {text offset, name offset into the strings, low half of the name's hash, 0}, each at its slot
+#   displacements: one per bucket, see slot_of
+#   strings:       NUL terminated names
+# names are hashed with 64-bit FNV-1a, and placed with a minimal perfect hash (hash and displace): the low half of
+# the hash picks a bucket, whose displacement either holds the slot of its only name directly, or moves the high half
+# until every name in the bucket lands on a slot of its own.
+# v2 maps, which skyline still reads, have the same header with the buckets offset in place of the displacements
+# offset. Names are hashed with 32-bit FNV-1a and grouped by bucket, hash & (bucket count - 1), and bucket i holds the
+# symbols [buckets[i], buckets[i + 1]) of bucket count + 1 indices. They are only written on request, for testing.
+# v1 maps are a symbol count, followed by {offset, NUL terminated name} for every symbol.
+#
+# --verify checks that every symbol of a v3 map is found at its slot, --selftest round-trips a generated map
 
+import io
+import random
 import struct
 import sys
 
 FILTERED_SYMS = ['CustomAttributesCacheGenerator', 'RuntimeInvoker_', 'XmlSchema', 'Array_InternalArray_', 'jpt_', 'def_', 'sub_', 'Array_Resize_', 'Array_Reverse_', 'Array_Sort_']
 
-if len(sys.argv) < 2:
-	print("Syntax: python3 convertSymbolMap.py <map> <out>")
-	sys.exit()
+MAP_MAGIC = b"SKSM"
+MAP_VERSION = 3
+HEADER_FORMAT = "<4sIIIIIII"
+DISPLACEMENT_DIRECT = 0x80000000
+NAMES_PER_BUCKET = 4
 
-map_file = sys.argv[1];
-out_file = sys.argv[2];
+def read_map(map_file):
+	syms = []
+
+	with open(map_file, "r") as f:
+		while (line := f.readline()):
+			line = line.strip()
+			if line.startswith("Address"):
+				break
+			section_data = list(filter(None, line.split(' ')))
+			if len(section_data) < 3:
+				continue
+			id_and_start = section_data[0]
+			if not ':' in id_and_start:
+				continue
+			id = int(id_and_start.split(':')[0], base=16)
+			start = int(id_and_start.split(':')[1], base=16)
+			assert start == 0, 'Only a "start" value of zero is currently supported.'
+			length = int(section_data[1].rstrip('H'), base=16)
+			name = section_data[2]
+			print(f"id={id}, start={start}, length={length}, name={name}")
+
+		while (line := f.readline()):
+			line = line.strip()
+			section_data = list(filter(None, line.split(' ')))
+			if len(section_data) < 2:
+				continue
+
+			section_id_and_offset = section_data[0]
+			section_id = int(section_id_and_offset.split(':')[0], base=16)
+			offset = int(section_id_and_offset.split(':')[1], base=16)
+			sym_name = section_data[1]
+
+			included = True
+			for filt in FILTERED_SYMS:
+				if filt in sym_name:
+					included = False
+
+			if included:
+				syms.append((offset, sym_name))
+
+	return syms
+
+def fnv1a32(data):
+	h = 0x811c9dc5
+	for b in data:
+		h = ((h ^ b) * 0x01000193) & 0xffffffff
+	return h
+
+def fnv1a64(data):
+	h = 0xcbf29ce484222325
+	for b in data:
+		h = ((h ^ b) * 0x100000001b3) & 0xffffffffffffffff
+	return h
+
+# murmur3's finalizer
+def mix(value):
+	value &= 0xffffffff
+	value ^= value >> 16
+	value = (value * 0x85ebca6b) & 0xffffffff
+	value ^= value >> 13
+	value = (value * 0xc2b2ae35) & 0xffffffff
+	value ^= value >> 16
+	return value
 
-syms = []
+def displaced_slot(h, displacement, count):
+	return mix((h >> 32) + displacement * 0x9e3779b9) % count
 
-with open(map_file, "r") as f:
-	while (line := f.readline()):
-		line = line.strip()
-		if line.startswith("Address"):
+# mirrors slotOf in SymbolMap.cpp
+def slot_of(h, displacements, count):
+	displacement = displacements[h & (len(displacements) - 1)]
+	if displacement & DISPLACEMENT_DIRECT:
+		return displacement & ~DISPLACEMENT_DIRECT
+	return displaced_slot(h, displacement, count)
+
+# returns the displacements and the slot of every hash
+def build_index(hashes):
+	count = len(hashes)
+	bucket_count = 1
+	while bucket_count * NAMES_PER_BUCKET < count:
+		bucket_count *= 2
+
+	buckets = [[] for _ in range(bucket_count)]
+	for (i, h) in enumerate(hashes):
+		buckets[h & (bucket_count - 1)].append(i)
+
+	displacements = [0] * bucket_count
+	slots = [0] * count
+	taken = [False] * count
+	free = 0
+
+	# the biggest buckets are placed first, while most slots are still free
+	for bucket in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+		names = buckets[bucket]
+		if not names:
 			break
-		section_data = list(filter(None, line.split(' ')))
-		if len(section_data) < 3:
-			continue
-		id_and_start = section_data[0]
-		if not ':' in id_and_start:
-			continue
-		id = int(id_and_start.split(':')[0], base=16)
-		start = int(id_and_start.split(':')[1], base=16)
-		assert start == 0, 'Only a "start" value of zero is currently supported.'
-		length = int(section_data[1].rstrip('H'), base=16)
-		name = section_data[2]
-		print(f"id={id}, start={start}, length={length}, name={name}")
-
-	while (line := f.readline()):
-		line = line.strip()
-		section_data = list(filter(None, line.split(' ')))
-		if len(section_data) < 2:
+
+		if len(names) == 1:
+			while taken[free]:
+				free += 1
+			displacements[bucket] = DISPLACEMENT_DIRECT | free
+			slots[names[0]] = free
+			taken[free] = True
 			continue
 
-		section_id_and_offset = section_data[0]
-		section_id = int(section_id_and_offset.split(':')[0], base=16)
-		offset = int(section_id_and_offset.split(':')[1], base=16)
-		sym_name = section_data[1]
+		displacement = 0
+		while True:
+			candidates = [displaced_slot(hashes[i], displacement, count) for i in names]
+			if len(set(candidates)) == len(candidates) and not any(taken[c] for c in candidates):
+				break
+			displacement += 1
+			if displacement >= DISPLACEMENT_DIRECT:
+				sys.exit(f"Failed to place bucket {bucket}, are there names with the same hash?")
 
-		included = True
-		for filt in FILTERED_SYMS:
-			if filt in sym_name:
-				included = False
+		displacements[bucket] = displacement
+		for (i, c) in zip(names, candidates):
+			slots[i] = c
+			taken[c] = True
 
-		if included:
-			syms.append((offset, sym_name))
+	return (displacements, slots)
 
-with open(out_file, "wb") as f:
+def write_v1(f, syms):
 	f.write(struct.pack("i", len(syms)))
 	for sym in syms:
 		(offset, sym_name) = sym
 		f.write(struct.pack('i', offset))
 		f.write(sym_name.encode('ascii'))
 		f.write(b'\0')
+
+def write_v2(f, syms):
+	by_name = {}
+	for (offset, sym_name) in syms:
+		by_name[sym_name.encode('ascii')] = offset
+
+	bucket_count = 1
+	while bucket_count < len(by_name):
+		bucket_count *= 2
+
+	strings = bytearray()
+	entries = []
+	for (name, offset) in by_name.items():
+		h = fnv1a32(name)
+		entries.append((h & (bucket_count - 1), h, offset, len(strings)))
+		strings += name + b'\0'
+	entries.sort()
+	if not strings:
+		strings = b'\0'
+
+	buckets = [0] * (bucket_count + 1)
+	for entry in entries:
+		buckets[entry[0] + 1] += 1
+	for i in range(bucket_count):
+		buckets[i + 1] += buckets[i]
+
+	symbols_offset = struct.calcsize(HEADER_FORMAT)
+	buckets_offset = symbols_offset + len(entries) * 16
+	strings_offset = buckets_offset + len(buckets) * 4
+	f.write(struct.pack(HEADER_FORMAT, MAP_MAGIC, 2, len(entries), bucket_count, symbols_offset, buckets_offset,
+		strings_offset, len(strings)))
+	for (bucket, h, offset, name_offset) in entries:
+		f.write(struct.pack("<IIII", offset, name_offset, h, 0))
+	f.write(struct.pack(f"<{len(buckets)}I", *buckets))
+	f.write(strings)
+
+def write_v3(f, syms):
+	# later definitions win, as they do when skyline loads a v1 map
+	by_name = {}
+	for (offset, sym_name) in syms:
+		by_name[sym_name.encode('ascii')] = offset
+
+	names = list(by_name.keys())
+	hashes = [fnv1a64(name) for name in names]
+	(displacements, slots) = build_index(hashes)
+
+	strings = bytearray()
+	symbols = [None] * len(names)
+	for (i, name) in enumerate(names):
+		symbols[slots[i]] = (by_name[name], len(strings), hashes[i] & 0xffffffff)
+		strings += name + b'\0'
+	if not strings:
+		strings = b'\0'
+
+	symbols_offset = struct.calcsize(HEADER_FORMAT)
+	displacements_offset = symbols_offset + len(symbols) * 16
+	strings_offset = displacements_offset + len(displacements) * 4
+	f.write(struct.pack(HEADER_FORMAT, MAP_MAGIC, MAP_VERSION, len(symbols), len(displacements), symbols_offset,
+		displacements_offset, strings_offset, len(strings)))
+	for (offset, name_offset, h) in symbols:
+		f.write(struct.pack("<IIII", offset, name_offset, h, 0))
+	f.write(struct.pack(f"<{len(displacements)}I", *displacements))
+	f.write(strings)
+
+class IndexedMap:
+	def __init__(self, data):
+		(magic, version, self.count, bucket_count, symbols_offset, displacements_offset, strings_offset,
+			strings_size) = struct.unpack_from(HEADER_FORMAT, data)
+		if magic != MAP_MAGIC or version != MAP_VERSION:
+			raise ValueError("not a v3 symbol map")
+		self.symbols = [struct.unpack_from("<IIII", data, symbols_offset + i * 16) for i in range(self.count)]
+		self.displacements = list(struct.unpack_from(f"<{bucket_count}I", data, displacements_offset))
+		self.strings = bytes(data[strings_offset:strings_offset + strings_size])
+
+	def name_at(self, slot):
+		start = self.symbols[slot][1]
+		return self.strings[start:self.strings.index(b'\0', start)]
+
+	# mirrors lookupIndexedMap in SymbolMap.cpp
+	def lookup(self, name):
+		if self.count == 0:
+			return None
+		h = fnv1a64(name)
+		slot = slot_of(h, self.displacements, self.count)
+		(offset, _, stored_hash, _) = self.symbols[slot]
+		if stored_hash != h & 0xffffffff or self.name_at(slot) != name:
+			return None
+		return offset
+
+def verify(data):
+	indexed = IndexedMap(data)
+	for (slot, (offset, _, _, _)) in enumerate(indexed.symbols):
+		name = indexed.name_at(slot)
+		if indexed.lookup(name) != offset:
+			sys.exit(f"Symbol {name.decode('ascii')} is not found at its slot")
+	return indexed
+
+def selftest(count):
+	rng = random.Random(count)
+	syms = []
+	for i in range(count):
+		name = "".join(rng.choice("abcdefghijklmnopqrstuvwxyz_0123456789") for _ in range(rng.randint(1, 40)))
+		syms.append((rng.randrange(0x80000000), f"{name}_{i}"))
+
+	f = io.BytesIO()
+	write_v3(f, syms)
+	indexed = verify(f.getbuffer())
+	for (offset, name) in syms:
+		if indexed.lookup(name.encode('ascii')) != offset:
+			sys.exit(f"Symbol {name} does not round-trip")
+	for i in range(count):
+		if indexed.lookup(f"missing_{i}".encode('ascii')) is not None:
+			sys.exit(f"missing_{i} was found")
+	print(f"Round-tripped {count} symbols ({len(f.getbuffer())} bytes)")
+
+if len(sys.argv) >= 2 and sys.argv[1] == "--selftest":
+	selftest(int(sys.argv[2]) if len(sys.argv) > 2 else 100000)
+	sys.exit()
+
+if len(sys.argv) >= 3 and sys.argv[1] == "--verify":
+	with open(sys.argv[2], "rb") as f:
+		indexed = verify(f.read())
+	print(f"{indexed.count} symbols verified")
+	sys.exit()
+
+if len(sys.argv) < 3 or (len(sys.argv) > 3 and sys.argv[3] not in ("v1", "v2", "v3")):
+	print("Syntax: python3 convertSymbolMap.py <map> <out> [v1|v2|v3]")
+	print("        python3 convertSymbolMap.py --verify <out>")
+	print("        python3 convertSymbolMap.py --selftest [count]")
+	sys.exit()
+
+map_file = sys.argv[1];
+out_file = sys.argv[2];
+map_format = sys.argv[3] if len(sys.argv) > 3 else "v3"
+
+syms = read_map(map_file)
+
+with open(out_file, "wb") as f:
+	if map_format == "v1":
+		write_v1(f, syms)
+	elif map_format == "v2":
+		write_v2(f, syms)
+	else:
+		write_v3(f, syms)
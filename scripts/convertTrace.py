@@ -0,0 +1,79 @@
+# Convert a capture of the logger socket (e.g. nc <switch ip> 6969 > trace.bin) holding A64TraceHook and
+# skyline::profile frames into a Chrome trace, which chrome://tracing and ui.perfetto.dev both open, and Tracy's
+# import-chrome turns into a Tracy capture. Text log lines around the frames are skipped
+
+import json
+import struct
+import sys
+
+FRAME_MAGIC = b'SKTR'
+FRAME_HEADER = struct.Struct('<4sHHI')
+RECORD = struct.Struct('<QII')
+RECORD_EXIT = 0x80000000
+RECORD_FRAME = 0x7fffffff
+
+FRAME_INFO = 0
+FRAME_NAME = 1
+FRAME_RECORDS = 2
+
+if len(sys.argv) < 3:
+	print("Syntax: python3 convertTrace.py <capture> <out.json>")
+	sys.exit()
+
+with open(sys.argv[1], "rb") as f:
+	data = f.read()
+
+frequency = None
+names = {}
+records = []
+
+pos = data.find(FRAME_MAGIC)
+while pos != -1 and pos + FRAME_HEADER.size <= len(data):
+	(magic, type, reserved, size) = FRAME_HEADER.unpack_from(data, pos)
+	payload = data[pos + FRAME_HEADER.size:pos + FRAME_HEADER.size + size]
+	if len(payload) < size:
+		print("Capture ends in the middle of a frame, dropping it")
+		break
+
+	if type == FRAME_INFO:
+		(frequency,) = struct.unpack_from('<Q', payload)
+	elif type == FRAME_NAME:
+		(id,) = struct.unpack_from('<I', payload)
+		names[id] = payload[4:].decode('utf-8', errors='replace')
+	elif type == FRAME_RECORDS:
+		records.extend(RECORD.iter_unpack(payload))
+
+	pos = data.find(FRAME_MAGIC, pos + FRAME_HEADER.size + size)
+
+if frequency is None:
+	print("No info frame in the capture, assuming the 19.2 MHz system tick")
+	frequency = 19200000
+
+# rings are drained one after the other, so records only come in order per thread
+records.sort(key=lambda record: record[0])
+start = records[0][0] if records else 0
+
+events = []
+for (tick, id, thread) in records:
+	ts = (tick - start) * 1000000 / frequency
+	if id == RECORD_FRAME:
+		events.append({"name": "frame", "ph": "i", "s": "g", "ts": ts, "pid": 0, "tid": thread})
+		continue
+
+	hook = id & ~RECORD_EXIT
+	events.append({
+		"name": names.get(hook, f"hook {hook}"),
+		"ph": "E" if id & RECORD_EXIT else "B",
+		"ts": ts,
+		"pid": 0,
+		"tid": thread,
+	})
+
+unnamed = {id & ~RECORD_EXIT for (_, id, _) in records if id != RECORD_FRAME} - names.keys()
+if unnamed:
+	print(f"{len(unnamed)} hooks have no name frame in the capture, they are labelled by id")
+
+with open(sys.argv[2], "w") as f:
+	json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, f)
+
+print(f"Wrote {len(events)} events for {len(names)} hooks and zones")
@@ -1,5 +1,7 @@
 #include "main.hpp"
 
+#include "skyline/hook/Hook.hpp"
+#include "skyline/inlinehook/deferred.hpp"
 #include "skyline/logger/TcpLogger.hpp"
 #include "skyline/utils/ipc.hpp"
 #include "skyline/utils/cpputils.hpp"
@@ -13,16 +15,30 @@ nn::os::UserExceptionInfo exception_info;
 
 const char* RomMountName = "rom";
 
+// logs a register, along with the symbol it points into if any. the symbol is left out if the indices are busy, the
+// crash may have happened while they were locked
+static void logRegister(const char* name, u64 value) {
+    const char* symbol;
+    uintptr_t offset;
+    if (skyline::utils::SymbolMap::trySymbolize(value, &symbol, &offset))
+        skyline::logger::s_Instance->LogFormat("%s: %" PRIx64 " (%s+0x%" PRIxPTR ")", name, value, symbol, offset);
+    else
+        skyline::logger::s_Instance->LogFormat("%s: %" PRIx64, name, value);
+}
+
 void exception_handler(nn::os::UserExceptionInfo* info) {
     skyline::logger::s_Instance->LogFormat("Exception occurred!");
 
     skyline::logger::s_Instance->LogFormat("Error description: %x", info->ErrorDescription);
-    for (int i = 0; i < 29; i++)
-        skyline::logger::s_Instance->LogFormat("X[%02i]: %" PRIx64, i, info->CpuRegisters[i].x);
+    for (int i = 0; i < 29; i++) {
+        char name[8];
+        snprintf(name, sizeof(name), "X[%02i]", i);
+        logRegister(name, info->CpuRegisters[i].x);
+    }
     skyline::logger::s_Instance->LogFormat("FP: %" PRIx64, info->FP.x);
-    skyline::logger::s_Instance->LogFormat("LR: %" PRIx64, info->LR.x);
+    logRegister("LR", info->LR.x);
     skyline::logger::s_Instance->LogFormat("SP: %" PRIx64, info->SP.x);
-    skyline::logger::s_Instance->LogFormat("PC: %" PRIx64, info->PC.x);
+    logRegister("PC", info->PC.x);
     skyline::logger::s_Instance->Flush();
 }
 
@@ -32,7 +48,7 @@ void* handleLookupGlobalManual(const char* symName) {
     void* (*func_ptr)(const char*) = (void* (*)(const char*))(lookupGlobalManualImpl);
     void* result = func_ptr(symName);
     if (result == nullptr) {
-        uintptr_t mapValue = skyline::utils::SymbolMap::getSymbolAddress(std::string(symName));
+        uintptr_t mapValue = skyline::utils::SymbolMap::getSymbolAddress(symName);
         return reinterpret_cast<void*>(mapValue);
     }
     return result;
@@ -42,18 +58,16 @@ void* handleLookupGlobalManual(const void* module, const char* symName) {
     void* (*func_ptr)(const void*, const char*) = (void* (*)(const void*, const char*))(lookupGlobalManualImpl);
     void* result = func_ptr(module, symName);
     if (result == nullptr) {
-        uintptr_t mapValue = skyline::utils::SymbolMap::getSymbolAddress(std::string(symName));
+        uintptr_t mapValue = skyline::utils::SymbolMap::getSymbolAddress(symName);
         return reinterpret_cast<void*>(mapValue);
     }
     return result;
 }
 
-Result (*handleLookupSymbolImpl)(uintptr_t* pOutAddress, const char* name);
-
 Result handleLookupSymbol(uintptr_t* pOutAddress, const char* name) {
-    Result res = handleLookupSymbolImpl(pOutAddress, name);
+    Result res = skyline::hook::Hook<nn::ro::LookupSymbol>::original(pOutAddress, name);
     if (R_FAILED(res)) {
-        uintptr_t mapValue = skyline::utils::SymbolMap::getSymbolAddress(std::string(name));
+        uintptr_t mapValue = skyline::utils::SymbolMap::getSymbolAddress(name);
         if (mapValue != 0) {
             *pOutAddress = mapValue;
             return 0;
@@ -73,9 +87,9 @@ static skyline::utils::Task* after_romfs_task = new skyline::utils::Task{[]() {
     Result rc = nn::fs::MountSdCardForDebug("sd");
     skyline::logger::s_Instance->LogFormat("[skyline_main] Mounted SD (0x%x)", rc);
 
-    // Load symbol map
-    if (skyline::utils::SymbolMap::tryLoad()) {
-        // If a symbol map was loaded, hook the global symbol lookup function
+    // Load symbol map in the background, lookups that need it wait for it
+    if (skyline::utils::SymbolMap::startLoad()) {
+        // If a symbol map is being loaded, hook the global symbol lookup function
         // Apparently, this function isn't called for every symbol, but always if a symbol couldn't be found
         if (auto func_ptr = (void* (*)(const char*))nn::ro::detail::LookupGlobalManual) {
             A64HookFunction(reinterpret_cast<void*>(func_ptr),
@@ -90,8 +104,7 @@ static skyline::utils::Task* after_romfs_task = new skyline::utils::Task{[]() {
                 "Symbols from maps cannot be used.");
         }
         // Also handle manual calls to nn::ro::LookupSymbol
-        A64HookFunction(reinterpret_cast<void*>(nn::ro::LookupSymbol), reinterpret_cast<void*>(handleLookupSymbol),
-           reinterpret_cast<void**>(&handleLookupSymbolImpl));
+        skyline::hook::Hook<nn::ro::LookupSymbol>::install(handleLookupSymbol);
 
         skyline::logger::s_Instance->LogFormat("[skyline_main] Installed symbol map hooks.");
     }
@@ -103,11 +116,9 @@ static skyline::utils::Task* after_romfs_task = new skyline::utils::Task{[]() {
 
 void stub() {}
 
-Result (*nnFsMountRomImpl)(char const*, void*, unsigned long);
-
-Result handleNnFsMountRom(char const* path, void* buffer, unsigned long size) {
+Result handleNnFsMountRom(char const* path, void* buffer, ulong size) {
     Result rc = 0;
-    rc = nnFsMountRomImpl(path, buffer, size);
+    rc = skyline::hook::Hook<nn::fs::MountRom>::original(path, buffer, size);
 
     skyline::utils::g_RomMountStr = std::string(path) + ":/";
 
@@ -141,14 +152,13 @@ void handleNnDiagDetailVAbortImpl(char const* str1, char const* str2, char const
 }
 
 static skyline::utils::Once g_RoInit;
-Result (*nnRoInitializeImpl)();
 Result (*userExceptionHandlerStub)();
 
 Result nn_ro_init() {
     Result ret = 0;
 
     g_RoInit.call_once([&ret]() {
-         ret = nnRoInitializeImpl();
+         ret = skyline::hook::Hook<nn::ro::Initialize>::original();
     });
 
     return ret;
@@ -173,13 +183,17 @@ void skyline_main() {
     nn::os::SetUserExceptionHandler(exception_handler, exception_handler_stack, sizeof(exception_handler_stack),
                                     &exception_info);
 
-    // hook to prevent the game from double mounting romfs
-    A64HookFunction(reinterpret_cast<void*>(nn::fs::MountRom), reinterpret_cast<void*>(handleNnFsMountRom),
-                    (void**)&nnFsMountRomImpl);
-
-    A64HookFunction(reinterpret_cast<void*>(nn::ro::Initialize), reinterpret_cast<void*>(nn_ro_init), (void**)&nnRoInitializeImpl);
-
-    A64HookFunction(reinterpret_cast<void*>(nn::os::SetUserExceptionHandler), reinterpret_cast<void*>(stub), (void**)&userExceptionHandlerStub);
+    const HookSpec bootHooks[] = {
+        // hook to prevent the game from double mounting romfs
+        skyline::hook::Hook<nn::fs::MountRom>::spec(handleNnFsMountRom),
+        skyline::hook::Hook<nn::ro::Initialize>::spec(nn_ro_init),
+        {reinterpret_cast<void*>(nn::os::SetUserExceptionHandler), reinterpret_cast<void*>(stub),
+         (void**)&userExceptionHandlerStub},
+    };
+    A64HookFunctionBatch(bootHooks, sizeof(bootHooks) / sizeof(bootHooks[0]));
+
+    // install deferred hooks as the modules they target are loaded
+    skyline::inlinehook::DeferredHooks::trackModules();
 
     skyline::logger::s_Instance->LogFormat("[skyline_main] text: 0x%" PRIx64 " | rodata: 0x%" PRIx64
                                            " | data: 0x%" PRIx64 " | bss: 0x%" PRIx64 " | heap: 0x%" PRIx64,
@@ -29,465 +29,33 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
-#if defined(__aarch64__)
+#include <algorithm>
+#include <map>
+#include <vector>
 
+#if defined(__aarch64__) || defined(SKYLINE_STANDIN)
+
+#include "mem.h"
 #include "nn/os.h"
 #include "skyline/inlinehook/And64InlineHook.hpp"
+#include "skyline/inlinehook/deferred.hpp"
+#include "skyline/inlinehook/installstats.hpp"
+#include "skyline/inlinehook/probes.hpp"
+#include "skyline/inlinehook/relocator.hpp"
+#include "skyline/inlinehook/tracing.hpp"
+#include "skyline/inlinehook/trampolinepool.hpp"
+#include "skyline/utils/call_once.hpp"
 #include "skyline/utils/cpputils.hpp"
 
-#define A64_MAX_INSTRUCTIONS 5
-#define A64_MAX_REFERENCES (A64_MAX_INSTRUCTIONS * 2)
-#define A64_NOP 0xd503201fu
-typedef uint32_t* __restrict* __restrict instruction;
-typedef struct {
-    struct fix_info {
-        uint32_t* bprx;
-        uint32_t* bprw;
-        uint32_t ls;  // left-shift counts
-        uint32_t ad;  // & operand
-    };
-    struct insns_info {
-        union {
-            uint64_t insu;
-            int64_t ins;
-            void* insp;
-        };
-        fix_info fmap[A64_MAX_REFERENCES];
-    };
-    int64_t basep;
-    int64_t endp;
-    insns_info dat[A64_MAX_INSTRUCTIONS];
-
-   public:
-    inline bool is_in_fixing_range(const int64_t absolute_addr) {
-        return absolute_addr >= this->basep && absolute_addr < this->endp;
-    }
-    inline intptr_t get_ref_ins_index(const int64_t absolute_addr) {
-        return static_cast<intptr_t>((absolute_addr - this->basep) / sizeof(uint32_t));
-    }
-    inline intptr_t get_and_set_current_index(uint32_t* __restrict inp, uint32_t* __restrict outp) {
-        intptr_t current_idx = this->get_ref_ins_index(reinterpret_cast<int64_t>(inp));
-        this->dat[current_idx].insp = outp;
-        return current_idx;
-    }
-    inline void reset_current_ins(const intptr_t idx, uint32_t* __restrict outp) { this->dat[idx].insp = outp; }
-    void insert_fix_map(const intptr_t idx, uint32_t* bprw, uint32_t* bprx, uint32_t ls = 0u,
-                        uint32_t ad = 0xffffffffu) {
-        for (auto& f : this->dat[idx].fmap) {
-            if (f.bprw == NULL) {
-                f.bprw = bprw;
-                f.bprx = bprx;
-                f.ls = ls;
-                f.ad = ad;
-                return;
-            }  // if
-        }
-        // What? GGing..
-    }
-    void process_fix_map(const intptr_t idx) {
-        for (auto& f : this->dat[idx].fmap) {
-            if (f.bprw == NULL) break;
-            *(f.bprw) =
-                *(f.bprx) | (((int32_t(this->dat[idx].ins - reinterpret_cast<int64_t>(f.bprx)) >> 2) << f.ls) & f.ad);
-            f.bprw = NULL;
-            f.bprx = NULL;
-        }
-    }
-} context;
-
-//-------------------------------------------------------------------------
-
-static bool __fix_branch_imm(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                             context* ctxp) {
-    static constexpr uint32_t mbits = 6u;
-    static constexpr uint32_t mask = 0xfc000000u;   // 0b11111100000000000000000000000000
-    static constexpr uint32_t rmask = 0x03ffffffu;  // 0b00000011111111111111111111111111
-    static constexpr uint32_t op_b = 0x14000000u;   // "b"  ADDR_PCREL26
-    static constexpr uint32_t op_bl = 0x94000000u;  // "bl" ADDR_PCREL26
-
-    const uint32_t ins = *(*inprwp);
-    const uint32_t opc = ins & mask;
-    switch (opc) {
-        case op_b:
-        case op_bl: {
-            intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-            int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) +
-                                    (static_cast<int32_t>(ins << mbits) >> (mbits - 2u));  // sign-extended
-            int64_t new_pc_offset =
-                static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
-            bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-            // whether the branch should be converted to absolute jump
-            if (!special_fix_type && llabs(new_pc_offset) >= (rmask >> 1)) {
-                bool b_aligned = (reinterpret_cast<uint64_t>(*outprx + 2) & 7u) == 0u;
-                if (opc == op_b) {
-                    if (b_aligned != true) {
-                        (*outprw)[0] = A64_NOP;
-                        ctxp->reset_current_ins(current_idx, ++(*outprx));
-                        ++(*outprw);
-                    }                            // if
-                    (*outprw)[0] = 0x58000051u;  // LDR X17, #0x8
-                    (*outprw)[1] = 0xd61f0220u;  // BR X17
-                    memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));
-                    *outprx += 4;
-                    *outprw += 4;
-                } else {
-                    if (b_aligned == true) {
-                        (*outprw)[0] = A64_NOP;
-                        ctxp->reset_current_ins(current_idx, ++(*outprx));
-                        (*outprw)++;
-                    }                            // if
-                    (*outprw)[0] = 0x58000071u;  // LDR X17, #12
-                    (*outprw)[1] = 0x1000009eu;  // ADR X30, #16
-                    (*outprw)[2] = 0xd61f0220u;  // BR X17
-                    memcpy(*outprw + 3, &absolute_addr, sizeof(absolute_addr));
-                    *outprw += 5;
-                    *outprx += 5;
-                }  // if
-            } else {
-                if (special_fix_type) {
-                    intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr);
-                    if (ref_idx <= current_idx) {
-                        new_pc_offset =
-                            static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx)) >> 2;
-                    } else {
-                        ctxp->insert_fix_map(ref_idx, *outprw, *outprx, 0u, rmask);
-                        new_pc_offset = 0;
-                    }  // if
-                }      // if
-
-                (*outprw)[0] = opc | (new_pc_offset & ~mask);
-                ++(*outprw);
-                ++(*outprx);
-            }  // if
-
-            ++(*inprxp);
-            ++(*inprwp);
-            return ctxp->process_fix_map(current_idx), true;
-        }
-    }
-    return false;
-}
-
-//-------------------------------------------------------------------------
-
-static bool __fix_cond_comp_test_branch(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                                        context* ctxp) {
-    static constexpr uint32_t lsb = 5u;
-    static constexpr uint32_t lmask01 = 0xff00001fu;  // 0b11111111000000000000000000011111
-    static constexpr uint32_t mask0 = 0xff000010u;    // 0b11111111000000000000000000010000
-    static constexpr uint32_t op_bc = 0x54000000u;    // "b.c"  ADDR_PCREL19
-    static constexpr uint32_t mask1 = 0x7f000000u;    // 0b01111111000000000000000000000000
-    static constexpr uint32_t op_cbz = 0x34000000u;   // "cbz"  Rt, ADDR_PCREL19
-    static constexpr uint32_t op_cbnz = 0x35000000u;  // "cbnz" Rt, ADDR_PCREL19
-    static constexpr uint32_t lmask2 = 0xfff8001fu;   // 0b11111111111110000000000000011111
-    static constexpr uint32_t mask2 = 0x7f000000u;    // 0b01111111000000000000000000000000
-    static constexpr uint32_t op_tbz =
-        0x36000000u;  // 0b00110110000000000000000000000000 "tbz"  Rt, BIT_NUM, ADDR_PCREL14
-    static constexpr uint32_t op_tbnz =
-        0x37000000u;  // 0b00110111000000000000000000000000 "tbnz" Rt, BIT_NUM, ADDR_PCREL14
-
-    const uint32_t ins = *(*inprwp);
-    uint32_t lmask = lmask01;
-    if ((ins & mask0) != op_bc) {
-        uint32_t opc = ins & mask1;
-        if (opc != op_cbz && opc != op_cbnz) {
-            opc = ins & mask2;
-            if (opc != op_tbz && opc != op_tbnz) {
-                return false;
-            }  // if
-            lmask = lmask2;
-        }  // if
-    }      // if
-
-    intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-    int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) + ((ins & ~lmask) >> (lsb - 2u));
-    int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
-    bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-    if (!special_fix_type && llabs(new_pc_offset) >= (~lmask >> (lsb + 1))) {
-        if ((reinterpret_cast<uint64_t>(*outprx + 4) & 7u) != 0u) {
-            (*outprw)[0] = A64_NOP;
-            ctxp->reset_current_ins(current_idx, *outprx);
-
-            (*outprx)++;
-            (*outprw)++;
-        }                                                               // if
-        (*outprw)[0] = (((8u >> 2u) << lsb) & ~lmask) | (ins & lmask);  // B.C #0x8
-        (*outprw)[1] = 0x14000005u;                                     // B #0x14
-        (*outprw)[2] = 0x58000051u;                                     // LDR X17, #0x8
-        (*outprw)[3] = 0xd61f0220u;                                     // BR X17
-        memcpy(*outprw + 4, &absolute_addr, sizeof(absolute_addr));
-        *outprw += 6;
-        *outprx += 6;
-    } else {
-        if (special_fix_type) {
-            intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr);
-            if (ref_idx <= current_idx) {
-                new_pc_offset = static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx)) >> 2;
-            } else {
-                ctxp->insert_fix_map(ref_idx, *outprw, *outprx, lsb, ~lmask);
-                new_pc_offset = 0;
-            }  // if
-        }      // if
-
-        (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << lsb) & ~lmask) | (ins & lmask);
-        ++(*outprw);
-        ++(*outprx);
-    }  // if
-
-    ++(*inprxp);
-    ++(*inprwp);
-    return ctxp->process_fix_map(current_idx), true;
-}
-
-//-------------------------------------------------------------------------
-
-static bool __fix_loadlit(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                          context* ctxp) {
-    const uint32_t ins = *(*inprwp);
-
-    // memory prefetch("prfm"), just skip it
-    // http://infocenter.arm.com/help/topic/com.arm.doc.100069_0608_00_en/pge1427897420050.html
-    if ((ins & 0xff000000u) == 0xd8000000u) {
-        ctxp->process_fix_map(ctxp->get_and_set_current_index(*inprxp, *outprx));
-        ++(*inprwp);
-        ++(*inprxp);
-        return true;
-    }  // if
-
-    static constexpr uint32_t msb = 8u;
-    static constexpr uint32_t lsb = 5u;
-    static constexpr uint32_t mask_30 = 0x40000000u;   // 0b01000000000000000000000000000000
-    static constexpr uint32_t mask_31 = 0x80000000u;   // 0b10000000000000000000000000000000
-    static constexpr uint32_t lmask = 0xff00001fu;     // 0b11111111000000000000000000011111
-    static constexpr uint32_t mask_ldr = 0xbf000000u;  // 0b10111111000000000000000000000000
-    static constexpr uint32_t op_ldr =
-        0x18000000u;  // 0b00011000000000000000000000000000 "LDR Wt/Xt, label" | ADDR_PCREL19
-    static constexpr uint32_t mask_ldrv = 0x3f000000u;  // 0b00111111000000000000000000000000
-    static constexpr uint32_t op_ldrv =
-        0x1c000000u;  // 0b00011100000000000000000000000000 "LDR St/Dt/Qt, label" | ADDR_PCREL19
-    static constexpr uint32_t mask_ldrsw = 0xff000000u;  // 0b11111111000000000000000000000000
-    static constexpr uint32_t op_ldrsw = 0x98000000u;  // "LDRSW Xt, label" | ADDR_PCREL19 | load register signed word
-    // LDR S0, #0 | 0b00011100000000000000000000000000 | 32-bit
-    // LDR D0, #0 | 0b01011100000000000000000000000000 | 64-bit
-    // LDR Q0, #0 | 0b10011100000000000000000000000000 | 128-bit
-    // INVALID    | 0b11011100000000000000000000000000 | may be 256-bit
-
-    uint32_t mask = mask_ldr;
-    uintptr_t faligned = (ins & mask_30) ? 7u : 3u;
-    if ((ins & mask_ldr) != op_ldr) {
-        mask = mask_ldrv;
-        if (faligned != 7u) faligned = (ins & mask_31) ? 15u : 3u;
-        if ((ins & mask_ldrv) != op_ldrv) {
-            if ((ins & mask_ldrsw) != op_ldrsw) {
-                return false;
-            }  // if
-            mask = mask_ldrsw;
-            faligned = 7u;
-        }  // if
-    }      // if
-
-    intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-    int64_t absolute_addr =
-        reinterpret_cast<int64_t>(*inprxp) + ((static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3u);
-    int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
-    bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-    // special_fix_type may encounter issue when there are mixed data and code
-    if (special_fix_type ||
-        (llabs(new_pc_offset) + (faligned + 1u - 4u) / 4u) >= (~lmask >> (lsb + 1))) {  // inaccurate, but it works
-        while ((reinterpret_cast<uint64_t>(*outprx + 2) & faligned) != 0u) {
-            *(*outprw)++ = A64_NOP;
-            (*outprx)++;
-        }
-        ctxp->reset_current_ins(current_idx, *outprx);
-
-        // Note that if memory at absolute_addr is writeable (non-const), we will fail to fetch it.
-        // And what's worse, we may unexpectedly overwrite something if special_fix_type is true...
-        uint32_t ns = static_cast<uint32_t>((faligned + 1) / sizeof(uint32_t));
-        (*outprw)[0] = (((8u >> 2u) << lsb) & ~mask) | (ins & lmask);  // LDR #0x8
-        (*outprw)[1] = 0x14000001u + ns;                               // B #0xc
-        memcpy(*outprw + 2, reinterpret_cast<void*>(absolute_addr), faligned + 1);
-        *outprw += 2 + ns;
-        *outprx += 2 + ns;
-    } else {
-        faligned >>= 2;  // new_pc_offset is shifted and 4-byte aligned
-        while ((new_pc_offset & faligned) != 0) {
-            *(*outprw)++ = A64_NOP;
-            (*outprx)++;
-            new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;
-        }
-        ctxp->reset_current_ins(current_idx, *outprx);
-
-        (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << lsb) & ~mask) | (ins & lmask);
-        ++(*outprx);
-        ++(*outprw);
-    }  // if
-
-    ++(*inprxp);
-    ++(*inprwp);
-    return ctxp->process_fix_map(current_idx), true;
-}
-
-//-------------------------------------------------------------------------
-
-static bool __fix_pcreladdr(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                            context* ctxp) {
-    // Load a PC-relative address into a register
-    // http://infocenter.arm.com/help/topic/com.arm.doc.100069_0608_00_en/pge1427897645644.html
-    static constexpr uint32_t msb = 8u;
-    static constexpr uint32_t lsb = 5u;
-    static constexpr uint32_t mask = 0x9f000000u;     // 0b10011111000000000000000000000000
-    static constexpr uint32_t rmask = 0x0000001fu;    // 0b00000000000000000000000000011111
-    static constexpr uint32_t lmask = 0xff00001fu;    // 0b11111111000000000000000000011111
-    static constexpr uint32_t fmask = 0x00ffffffu;    // 0b00000000111111111111111111111111
-    static constexpr uint32_t max_val = 0x001fffffu;  // 0b00000000000111111111111111111111
-    static constexpr uint32_t op_adr = 0x10000000u;   // "adr"  Rd, ADDR_PCREL21
-    static constexpr uint32_t op_adrp = 0x90000000u;  // "adrp" Rd, ADDR_ADRP
-
-    const uint32_t ins = *(*inprwp);
-    intptr_t current_idx;
-    switch (ins & mask) {
-        case op_adr: {
-            current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-            int64_t lsb_bytes = static_cast<uint32_t>(ins << 1u) >> 30u;
-            int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) +
-                                    (((static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3u) | lsb_bytes);
-            int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx));
-            bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-            if (!special_fix_type && llabs(new_pc_offset) >= (max_val >> 1)) {
-                if ((reinterpret_cast<uint64_t>(*outprx + 2) & 7u) != 0u) {
-                    (*outprw)[0] = A64_NOP;
-                    ctxp->reset_current_ins(current_idx, ++(*outprx));
-                    ++*(outprw);
-                }  // if
-
-                (*outprw)[0] = 0x58000000u | (((8u >> 2u) << lsb) & ~mask) | (ins & rmask);  // LDR #0x8
-                (*outprw)[1] = 0x14000003u;                                                  // B #0xc
-                memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));
-                *outprw += 4;
-                *outprx += 4;
-            } else {
-                if (special_fix_type) {
-                    intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr & ~3ull);
-                    if (ref_idx <= current_idx) {
-                        new_pc_offset =
-                            static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx));
-                    } else {
-                        ctxp->insert_fix_map(ref_idx, *outprw, *outprx, lsb, fmask);
-                        new_pc_offset = 0;
-                    }  // if
-                }      // if
-
-                // the lsb_bytes will never be changed, so we can use lmask to keep it
-                (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << (lsb - 2u)) & fmask) | (ins & lmask);
-                ++(*outprw);
-                ++(*outprx);
-            }  // if
-        } break;
-        case op_adrp: {
-            current_idx = ctxp->get_and_set_current_index(*inprxp, *outprw);
-            int32_t lsb_bytes = static_cast<uint32_t>(ins << 1u) >> 30u;
-            int64_t absolute_addr =
-                (reinterpret_cast<int64_t>(*inprxp) & ~0xfffll) +
-                ((((static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3u) | lsb_bytes) << 12);
-            skyline::logger::s_Instance->LogFormat("[And64InlineHook] ins = 0x%.8X, pc = %p, abs_addr = %p", ins,
-                                                   *inprxp, reinterpret_cast<int64_t*>(absolute_addr));
-            if (ctxp->is_in_fixing_range(absolute_addr)) {
-                intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr /* & ~3ull*/);
-                if (ref_idx > current_idx) {
-                    // the bottom 12 bits of absolute_addr are masked out,
-                    // so ref_idx must be less than or equal to current_idx!
-                    skyline::logger::s_Instance->Log(
-                        "[And64InlineHook] ref_idx must be less than or equal to current_idx!\n");
-                }  // if
-
-                // *absolute_addr may be changed due to relocation fixing
-                skyline::logger::s_Instance->Log("What is the correct way to fix this?\n");
-                *(*outprw)++ = ins;  // 0x90000000u;
-                (*outprx)++;
-            } else {
-                if ((reinterpret_cast<uint64_t>(*outprx + 2) & 7u) != 0u) {
-                    (*outprw)[0] = A64_NOP;
-                    ctxp->reset_current_ins(current_idx, ++(*outprx));
-                    ++*(outprw);
-                }  // if
-
-                (*outprw)[0] = 0x58000000u | (((8u >> 2u) << lsb) & ~mask) | (ins & rmask);  // LDR #0x8
-                (*outprw)[1] = 0x14000003u;                                                  // B #0xc
-                memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));                  // potential overflow?
-                *outprw += 4;
-                *outprx += 4;
-            }  // if
-        } break;
-        default:
-            return false;
-    }
-
-    ctxp->process_fix_map(current_idx);
-    ++(*inprxp);
-    ++(*inprwp);
-    return true;
+extern "C" {
+#include "skyline/nx/arm/counter.h"
 }
 
+#define A64_MAX_TRAMPOLINE_SIZE (A64_MAX_INSTRUCTIONS * 10u * sizeof(uint32_t))
 #define __flush_cache(c, n) __builtin___clear_cache(reinterpret_cast<char*>(c), reinterpret_cast<char*>(c) + n)
 
 //-------------------------------------------------------------------------
 
-static void __fix_instructions(uint32_t* __restrict inprw, uint32_t* __restrict inprx, int32_t count,
-                               uint32_t* __restrict outrwp, uint32_t* __restrict outrxp) {
-    context ctx;
-    ctx.basep = reinterpret_cast<int64_t>(inprx);
-    ctx.endp = reinterpret_cast<int64_t>(inprx + count);
-    memset(ctx.dat, 0, sizeof(ctx.dat));
-    static_assert(sizeof(ctx.dat) / sizeof(ctx.dat[0]) == A64_MAX_INSTRUCTIONS, "please use A64_MAX_INSTRUCTIONS!");
-#ifndef NDEBUG
-    if (count > A64_MAX_INSTRUCTIONS) {
-        skyline::logger::s_Instance->Log("[And64InlineHook] too many fixing instructions!\n");
-    }   // if
-#endif  // NDEBUG
-
-    uint32_t* const outprx_base = outrxp;
-    uint32_t* const outprw_base = outrwp;
-
-    while (--count >= 0) {
-        if (__fix_branch_imm(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-        if (__fix_cond_comp_test_branch(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-        if (__fix_loadlit(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-        if (__fix_pcreladdr(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-
-        // without PC-relative offset
-        ctx.process_fix_map(ctx.get_and_set_current_index(inprx, outrxp));
-        *(outrwp++) = *(inprw++);
-        outrxp++;
-        inprx++;
-    }
-
-    static constexpr uint_fast64_t mask = 0x03ffffffu;  // 0b00000011111111111111111111111111
-    auto callback = reinterpret_cast<int64_t>(inprx);
-    auto pc_offset = static_cast<int64_t>(callback - reinterpret_cast<int64_t>(outrxp)) >> 2;
-    if (llabs(pc_offset) >= (mask >> 1)) {
-        if ((reinterpret_cast<uint64_t>(outrxp + 2) & 7u) != 0u) {
-            outrwp[0] = A64_NOP;
-            ++outrxp;
-            ++outrwp;
-        }                         // if
-        outrwp[0] = 0x58000051u;  // LDR X17, #0x8
-        outrwp[1] = 0xd61f0220u;  // BR X17
-        *reinterpret_cast<int64_t*>(outrwp + 2) = callback;
-        outrwp += 4;
-        outrxp += 4;
-    } else {
-        outrwp[0] = 0x14000000u | (pc_offset & mask);  // "B" ADDR_PCREL26
-        ++outrwp;
-        ++outrxp;
-    }  // if
-
-    const uintptr_t total = (outrxp - outprx_base) * sizeof(uint32_t);
-    __flush_cache(outprx_base, total);  // necessary
-    __flush_cache(outprw_base, total);
-}
-
-//-------------------------------------------------------------------------
-
 #define __attribute __attribute__
 #define aligned(x) __aligned__(x)
 #define __intval(p) reinterpret_cast<intptr_t>(p)
@@ -501,8 +69,6 @@ static void __fix_instructions(uint32_t* __restrict inprw, uint32_t* __restrict
 #define __countof(x) static_cast<intptr_t>(sizeof(x) / sizeof((x)[0]))  // must be signed
 #define __atomic_increase(p) __sync_add_and_fetch(p, 1)
 #define __sync_cmpswap(p, v, n) __sync_bool_compare_and_swap(p, v, n)
-typedef uint32_t insns_t[A64_MAX_BACKUPS][A64_MAX_INSTRUCTIONS * 10u];
-
 constexpr size_t inline_hook_handler_size = 0xC;  // correct if handler size changes
 struct PACKED inline_hook_entry {
     std::array<uint8_t, inline_hook_handler_size> handler;
@@ -511,14 +77,8 @@ struct PACKED inline_hook_entry {
     const void* trampoline;
 };
 
-constexpr size_t inline_hook_size = sizeof(inline_hook_entry);
-constexpr size_t inline_hook_count = 0x1000;
-constexpr size_t inline_hook_pool_size = inline_hook_size * inline_hook_count;
-
 //-------------------------------------------------------------------------
 
-static Jit __insns_jit;
-static Jit __inline_hook_jit;
 static nn::os::MutexType hookMutex;
 
 //-------------------------------------------------------------------------
@@ -526,73 +86,86 @@ static nn::os::MutexType hookMutex;
 void A64HookInit() {
     nn::os::InitializeMutex(&hookMutex, false, 0);
 
-    // allocate normal hook JIT
-    Result rc = jitCreate(&__insns_jit, NULL, sizeof(insns_t));
-    R_ERRORONFAIL(rc);
-    memset(__insns_jit.rw_addr, 0, __insns_jit.size);
-    rc = jitTransitionToExecutable(&__insns_jit);
-    R_ERRORONFAIL(rc);
+    // trampolines and inline hook entries are allocated on demand by TrampolinePool
+}
 
-    // search for applicable space for inline hook JIT
-    auto cur_searching_addr =
-        skyline::utils::g_MainTextAddr - inline_hook_pool_size;  // start searching from right before .text
+//-------------------------------------------------------------------------
 
-    MemoryInfo mem;
-    while (true) {
-        u32 page_info;
-        if (R_SUCCEEDED(svcQueryMemory(&mem, &page_info, cur_searching_addr)) && mem.type == MemType_Unmapped &&
-            mem.size >= ALIGN_UP(inline_hook_pool_size, PAGE_SIZE)) {
-            break;
-        }
-        cur_searching_addr -= PAGE_SIZE;
-    }
+// instructions taken by the LDR/BR sequence at symbol, a NOP pads it when the literal would be misaligned
+static int32_t __ldr_br_count(void* const symbol) {
+    return (reinterpret_cast<uint64_t>(static_cast<uint32_t*>(symbol) + 2) & 7u) != 0u ? 5 : 4;
+}
 
-    // allocate inline hook JIT
-    rc = jitCreate(&__inline_hook_jit, (void*)ALIGN_DOWN(mem.addr + mem.size - inline_hook_pool_size, PAGE_SIZE),
-                   inline_hook_pool_size);
-    R_ERRORONFAIL(rc);
+// bytes overwritten when patching symbol to branch to replace
+static uintptr_t __hook_patch_size(void* const symbol, void* const replace) {
+    static constexpr uint_fast64_t mask = 0x03ffffffu;  // 0b00000011111111111111111111111111
+
+    auto pc_offset = static_cast<int64_t>(__intval(replace) - __intval(symbol)) >> 2;
+    return (llabs(pc_offset) >= (mask >> 1) ? __ldr_br_count(symbol) : 1) * sizeof(uint32_t);
 }
 
 //-------------------------------------------------------------------------
 
-static void FastAllocateTrampoline(uint32_t** rx, uint32_t** rw) {
-    static_assert((A64_MAX_INSTRUCTIONS * 10 * sizeof(uint32_t)) % 8 == 0, "8-byte align");
-    static volatile int32_t __index = -1;
+// instructions searched on either side of an in-place LDR/BR patch for branches into it
+#define A64_HAZARD_SCAN_INSTRUCTIONS 0x400
+
+// a single B only replaces the entry point, which is always safe. the in-place LDR/BR sequence needs all of the
+// instructions it covers to belong to the function and to not be branched into
+static bool __patch_is_safe(void* const symbol, void* const target) {
+    if (__hook_patch_size(symbol, target) == 1 * sizeof(uint32_t)) return true;
 
-    uint32_t i = __atomic_increase(&__index);
-    insns_t* rwptr = (insns_t*)__insns_jit.rw_addr;
-    insns_t* rxptr = (insns_t*)__insns_jit.rx_addr;
-    *rw = (*rwptr)[i];
-    *rx = (*rxptr)[i];
+    auto window = static_cast<const uint32_t*>(symbol);
+    int32_t count = __ldr_br_count(symbol);
+
+    // stay within the block holding the symbol, the ones around it may not be readable
+    MemoryInfo mem;
+    u32 page_info;
+    if (R_FAILED(svcQueryMemory(&mem, &page_info, __uintval(symbol)))) return false;
+    uintptr_t scan = A64_HAZARD_SCAN_INSTRUCTIONS * sizeof(uint32_t);
+    uintptr_t begin = MAX(mem.addr, __uintval(window) - MIN(scan, __uintval(window)));
+    uintptr_t end = MIN(mem.addr + mem.size, __uintval(window + count) + scan);
+
+    auto hazard = skyline::inlinehook::RelocationHazard::FunctionEnd;
+    if (end >= __uintval(window + count)) {
+        hazard = skyline::inlinehook::findRelocationHazard(window, count, reinterpret_cast<const uint32_t*>(begin),
+                                                           reinterpret_cast<const uint32_t*>(end));
+    }  // if
+    if (hazard == skyline::inlinehook::RelocationHazard::None) return true;
+
+    skyline::logger::s_Instance->LogFormat(
+        "[And64InlineHook] refusing to patch %u instructions at %p, %s", count, symbol,
+        hazard == skyline::inlinehook::RelocationHazard::FunctionEnd ? "the function ends inside the patch"
+                                                                     : "code branches into the patch");
+    return false;
 }
 
 //-------------------------------------------------------------------------
 
-void* A64HookFunctionV(void* const symbol, void* const replace, void* const rxtr, void* const rwtr,
-                       const uintptr_t rwx_size) {
+// patches an already claimed symbol, the caller is responsible for cache maintenance of both the symbol and the
+// trampoline (whose size in bytes is written to rwx_used)
+static void* __hook_function_claimed(void* const symbol, uint32_t* const rwsymbol, void* const replace,
+                                     void* const rxtr, void* const rwtr, const uintptr_t rwx_size,
+                                     uintptr_t* rwx_used) {
     static constexpr uint_fast64_t mask = 0x03ffffffu;  // 0b00000011111111111111111111111111
 
     uint32_t *rxtrampoline = static_cast<uint32_t*>(rxtr), *rwtrampoline = static_cast<uint32_t*>(rwtr),
-             *original = static_cast<uint32_t*>(symbol);
+             *original = rwsymbol;
+    *rwx_used = 0;
 
     static_assert(A64_MAX_INSTRUCTIONS >= 5, "please fix A64_MAX_INSTRUCTIONS!");
     auto pc_offset = static_cast<int64_t>(__intval(replace) - __intval(symbol)) >> 2;
     if (llabs(pc_offset) >= (mask >> 1)) {
-        skyline::inlinehook::ControlledPages control(original, 5 * sizeof(uint32_t));
-        control.claim();
-
-        int32_t count = (reinterpret_cast<uint64_t>(original + 2) & 7u) != 0u ? 5 : 4;
-
-        original = (u32*)control.rw;
+        int32_t count = __ldr_br_count(symbol);
 
         if (rxtrampoline) {
             if (rwx_size < count * 10u) {
                 skyline::logger::s_Instance->LogFormat(
                     "[And64InlineHook] rwx size is too small to hold %u bytes backup instructions!", count * 10u);
-                control.unclaim();
                 return NULL;
             }  // if
-            __fix_instructions(original, (u32*)control.rx, count, rwtrampoline, rxtrampoline);
+            skyline::inlinehook::InstallTimer timer(skyline::inlinehook::InstallPhase_Relocate);
+            *rwx_used = skyline::inlinehook::relocateInstructions(original, static_cast<uint32_t*>(symbol), count,
+                                                                  rwtrampoline, rxtrampoline);
         }  // if
 
         if (count == 5) {
@@ -602,37 +175,27 @@ void* A64HookFunctionV(void* const symbol, void* const replace, void* const rxtr
         original[0] = 0x58000051u;  // LDR X17, #0x8
         original[1] = 0xd61f0220u;  // BR X17
         *reinterpret_cast<int64_t*>(original + 2) = __intval(replace);
-        __flush_cache(symbol, 5 * sizeof(uint32_t));
 
         skyline::logger::s_Instance->LogFormat(
             "[And64InlineHook] inline hook %p->%p successfully! %zu bytes overwritten", symbol, replace,
-            5 * sizeof(uint32_t));
-
-        control.unclaim();
+            count * sizeof(uint32_t));
     } else {
-        skyline::inlinehook::ControlledPages control(original, 1 * sizeof(uint32_t));
-        control.claim();
-
-        original = (u32*)control.rw;
-
         if (rwtrampoline) {
             if (rwx_size < 1u * 10u) {
                 skyline::logger::s_Instance->LogFormat(
                     "[And64InlineHook] rwx size is too small to hold %u bytes backup instructions!", 1u * 10u);
-                control.unclaim();
                 return NULL;
             }  // if
-            __fix_instructions(original, (u32*)control.rx, 1, rwtrampoline, rxtrampoline);
+            skyline::inlinehook::InstallTimer timer(skyline::inlinehook::InstallPhase_Relocate);
+            *rwx_used = skyline::inlinehook::relocateInstructions(original, static_cast<uint32_t*>(symbol), 1,
+                                                                  rwtrampoline, rxtrampoline);
         }  // if
 
         __sync_cmpswap(original, *original, 0x14000000u | (pc_offset & mask));  // "B" ADDR_PCREL26
-        __flush_cache(symbol, 1 * sizeof(uint32_t));
 
         skyline::logger::s_Instance->LogFormat(
             "[And64InlineHook] inline hook %p->%p successfully! %zu bytes overwritten", symbol, replace,
             1 * sizeof(uint32_t));
-
-        control.unclaim();
     }  // if
 
     // if(rwtrampoline)
@@ -642,39 +205,907 @@ void* A64HookFunctionV(void* const symbol, void* const replace, void* const rxtr
 
 //-------------------------------------------------------------------------
 
-extern "C" void A64HookFunction(void* const symbol, void* const replace, void** result) {
+void* A64HookFunctionV(void* const symbol, void* const replace, void* const rxtr, void* const rwtr,
+                       const uintptr_t rwx_size) {
+    skyline::inlinehook::ControlledPages control(symbol, __hook_patch_size(symbol, replace));
+    control.claim();
+
+    uintptr_t rwx_used;
+    void* rxtrampoline = __hook_function_claimed(symbol, static_cast<uint32_t*>(control.rw), replace, rxtr, rwtr,
+                                                 rwx_size, &rwx_used);
+    if (rwx_used != 0) {
+        skyline::inlinehook::InstallTimer timer(skyline::inlinehook::InstallPhase_Cache);
+        __flush_cache(rxtr, rwx_used);  // necessary
+        __flush_cache(rwtr, rwx_used);
+    }  // if
+
+    // flushes the patched symbol
+    control.unclaim();
+    return rxtrampoline;
+}
+
+//-------------------------------------------------------------------------
+
+extern "C" void timeProbeEnter(void);
+extern "C" void timeProbeExit(void);
+
+static uint32_t __encode_ldr_literal(uint32_t rt, const uint32_t* pc, const void* literal) {
+    auto offset = static_cast<int64_t>(__intval(literal) - __intval(pc)) >> 2;
+    return 0x58000000u | ((offset & 0x7ffff) << 5) | rt;  // LDR Xt, literal
+}
+
+static uint32_t __encode_adr(uint32_t rd, const uint32_t* pc, const void* address) {
+    auto offset = static_cast<int64_t>(__intval(address) - __intval(pc));
+    return 0x10000000u | ((offset & 3) << 29) | (((offset >> 2) & 0x7ffff) << 5) | rd;  // ADR Xd, address
+}
+
+// writes a time probe block recording into stats (see TIME_PROBE_EXCLUSIVE), returning the offset of its entry. the
+// entry probe calls timeProbeEnter with x16 pointing at the block, which gives back where the function should return
+// to in x17: the exit probe at the start of the block, or the caller if the shadow stack is full. execution continues
+// right after the block
+#define A64_TIME_PROBE_SIZE (14 * sizeof(uint32_t))
+static size_t __emit_time_probe(uint32_t* rw, uint32_t* rx, uintptr_t stats) {
+    rw[0] = __encode_ldr_literal(17, rx + 0, rx + 6);    // LDR X17, timeProbeExit
+    rw[1] = 0xd61f0220u;                                 // BR X17
+    *reinterpret_cast<uintptr_t*>(rw + 2) = stats;
+    *reinterpret_cast<void (**)(void)>(rw + 4) = &timeProbeEnter;
+    *reinterpret_cast<void (**)(void)>(rw + 6) = &timeProbeExit;
+    rw[8] = 0xa9bf7bfdu;                                 // STP X29, X30, [SP, #-16]!
+    rw[9] = __encode_adr(16, rx + 9, rx);                // ADR X16, block
+    rw[10] = __encode_ldr_literal(17, rx + 10, rx + 4);  // LDR X17, timeProbeEnter
+    rw[11] = 0xd63f0220u;                                // BLR X17
+    rw[12] = 0xa8c17bfdu;                                // LDP X29, X30, [SP], #16
+    rw[13] = 0xaa1103feu;                                // MOV X30, X17
+    return 8 * sizeof(uint32_t);
+}
+
+//-------------------------------------------------------------------------
+
+struct InlineHookState;
+
+// instrumentation of a hook installed while stats are enabled. calls into the replacement go through a time probe,
+// and the replacement's result through one that takes the rest of the chain out of its time
+#define A64_MAX_HOOK_STATS 0x100
+#define A64_STATS_THUNK_SIZE (A64_TIME_PROBE_SIZE + 6 * sizeof(uint32_t))
+struct HookStatsSlot {
+    HookHandle handle;  // 0 while the slot is free
+    void* symbol;
+    void* replace;  // what the entry probe continues to
+    void* next;     // what the result probe continues to, kept up to date as the hook's result
+    HookTimeStats time;
+    skyline::inlinehook::Trampoline thunks[2];
+};
+
+// the probes point into their slot, so slots never move. free ones are handed out from a list and attached ones are
+// indexed by handle, neither the dump nor the install and remove paths go through the whole table
+static HookStatsSlot __hook_stats[A64_MAX_HOOK_STATS];
+static std::vector<HookStatsSlot*> __free_hook_stats;
+static size_t __hook_stats_used = 0;  // slots handed out at least once, the ones past it are free too
+static std::map<HookHandle, HookStatsSlot*> __attached_hook_stats;
+static bool __hook_stats_enabled = false;
+
+struct HookSubscriber {
+    void* replace;
+    void** result;
+    s32 priority;
+    HookHandle handle;
+    bool enabled;
+    InlineHookState* inline_state;  // entry owned by this hook if it is an inline hook
+    HookStatsSlot* stats;           // set if the hook was installed while stats were enabled
+};
+
+// every symbol hooked through A64HookFunction is tracked here. further hooks on the same symbol are chained in front
+// of the one relocated prologue instead of relocating the previous hook's patch, so they can be installed in any order
+struct HookSite {
+    void* original;        // relocated prologue, called once every subscriber passed the call on
+    void* head;            // what the symbol currently dispatches to
+    int64_t* literal;      // rx address of the literal the patch jumps through, NULL for a direct B
+    bool literal_in_pool;  // whether that literal lives in a veneer rather than in the patched symbol
+    std::vector<HookSubscriber> subscribers;  // in call order
+
+    uintptr_t patch_size;  // bytes the patch overwrote, 4 for a B, 16 or 20 for an LDR/BR sequence
+    uint32_t backup[5];    // instructions overwritten by the patch
+    uint32_t patched[5];   // the patch itself while it is not applied
+    bool applied;          // whether the symbol currently holds the patch
+
+    // code prefixed to the original by A64InlinePatch and the probes, which stays applied without subscribers
+    void* prefix;
+    HookHandle prefix_handle;  // 0 if the site has no prefix
+    bool prefix_enabled;
+    std::vector<skyline::inlinehook::Trampoline> allocations;  // trampoline and veneers, released with the site
+};
+
+static std::map<uintptr_t, HookSite> __hook_sites;
+static std::map<HookHandle, uintptr_t> __hook_handles;  // handle to hooked symbol
+static HookHandle __next_hook_handle = 1;
+
+// hands out the next handle, unless one was reserved up front by A64HookReserveHandle
+static HookHandle __take_handle(HookHandle reserved) { return reserved != 0 ? reserved : __next_hook_handle++; }
+
+//-------------------------------------------------------------------------
+
+// reserves a trampoline for a hook, logging on failure. sites always get one, later subscribers may need the original
+static bool __reserve_trampoline(void* const symbol, size_t size, skyline::inlinehook::Trampoline* trampoline) {
+    // a trampoline close to the symbol can branch back with a plain B instead of LDR/BR
+    Result rc = skyline::inlinehook::TrampolinePool::reserve(size, trampoline, __uintval(symbol));
+    if (R_FAILED(rc)) rc = skyline::inlinehook::TrampolinePool::reserve(size, trampoline);
+    if (R_FAILED(rc)) {
+        skyline::logger::s_Instance->LogFormat("[And64InlineHook] failed to allocate trampoline for %p (0x%x)", symbol,
+                                               rc);
+        return false;
+    }  // if
+    return true;
+}
+
+static void __release_allocations(HookSite& site) {
+    for (auto& allocation : site.allocations) skyline::inlinehook::TrampolinePool::release(&allocation);
+    site.allocations.clear();
+}
+
+//-------------------------------------------------------------------------
+
+// writes an LDR/BR veneer to replace within B range of symbol, returning its literal
+static int64_t* __make_veneer(void* const symbol, void* const replace, HookSite* site, void** veneer_rx) {
+    skyline::inlinehook::Trampoline veneer;
+    if (R_FAILED(skyline::inlinehook::TrampolinePool::reserve(4 * sizeof(uint32_t), &veneer, __uintval(symbol)))) {
+        return NULL;
+    }  // if
+
+    veneer.rw[0] = 0x58000051u;  // LDR X17, #0x8
+    veneer.rw[1] = 0xd61f0220u;  // BR X17
+    *reinterpret_cast<int64_t*>(veneer.rw + 2) = __intval(replace);
+    site->allocations.push_back(veneer);
+
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] %p->%p routed through veneer at %p", symbol, replace,
+                                           veneer.rx);
+    *veneer_rx = veneer.rx;
+    return reinterpret_cast<int64_t*>(veneer.rx + 2);
+}
+
+//-------------------------------------------------------------------------
+
+// returns what the symbol should branch to. replacements out of B range are reached through a veneer placed within
+// range of the symbol, keeping the patch a single instruction instead of an in-place LDR/BR sequence
+static void* __branch_target(void* const symbol, void* const replace, HookSite* site) {
+    site->literal = NULL;
+    site->literal_in_pool = false;
+    if (__hook_patch_size(symbol, replace) == 1 * sizeof(uint32_t)) return replace;
+
+    void* veneer;
+    site->literal = __make_veneer(symbol, replace, site, &veneer);
+    if (site->literal != NULL) {
+        site->literal_in_pool = true;
+        return veneer;
+    }  // if
+
+    // fall back to patching the LDR/BR sequence into the symbol, mirroring the layout of __hook_function_claimed
+    site->literal = reinterpret_cast<int64_t*>(static_cast<uint32_t*>(symbol) + __ldr_br_count(symbol) - 2);
+    return replace;
+}
+
+//-------------------------------------------------------------------------
+
+// patches a claimed symbol for a new site, keeping the overwritten instructions so the patch can be undone. the
+// relocated prologue goes prefix_size bytes into the trampoline, which the site takes ownership of
+static Result __install_site_claimed(HookSite& site, void* const symbol, uint32_t* const rwsymbol, void* const target,
+                                     skyline::inlinehook::Trampoline& trampoline, size_t prefix_size,
+                                     void** rxtrampoline) {
+    site.allocations.push_back(trampoline);
+    if (!__patch_is_safe(symbol, target)) {
+        __release_allocations(site);
+        return MAKERESULT(Module_Skyline, SkylineError_UnsafeHookTarget);
+    }  // if
+
+    site.patch_size = __hook_patch_size(symbol, target);
+    memcpy(site.backup, rwsymbol, site.patch_size);
+
+    uintptr_t rwx_used;
+    *rxtrampoline =
+        __hook_function_claimed(symbol, rwsymbol, target, trampoline.rx + prefix_size / sizeof(uint32_t),
+                                trampoline.rw + prefix_size / sizeof(uint32_t), A64_MAX_INSTRUCTIONS * 10u, &rwx_used);
+    if (*rxtrampoline == NULL) {
+        __release_allocations(site);
+        return MAKERESULT(Module_Skyline, SkylineError_TrampolineTooLarge);
+    }  // if
+
+    skyline::inlinehook::TrampolinePool::commit(&site.allocations.back(), prefix_size + rwx_used);
+    site.applied = true;
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+
+// points an installed site at a new head without touching the relocated prologue
+static bool __retarget_site(void* const symbol, HookSite& site, void* const head) {
+    int64_t value = __intval(head);
+    if (site.literal_in_pool) {
+        if (R_SUCCEEDED(skyline::inlinehook::TrampolinePool::write(site.literal, &value, sizeof(value)))) {
+            site.head = head;
+            return true;
+        }  // if
+
+        // the veneer sits in a sealed region, the symbol's B is pointed at a new one instead
+        site.literal = NULL;
+        site.literal_in_pool = false;
+    }  // if
+
+    if (site.literal != NULL) {
+        skyline::inlinehook::ControlledPages control(site.literal, sizeof(value));
+        control.claim();
+        __atomic_store_n(static_cast<int64_t*>(control.rw), value, __ATOMIC_RELEASE);
+        control.unclaim();
+    } else {
+        static constexpr uint_fast64_t mask = 0x03ffffffu;  // 0b00000011111111111111111111111111
+
+        // the symbol holds a single B, anything further away has to go through a new veneer
+        void* target = head;
+        if (__hook_patch_size(symbol, head) != 1 * sizeof(uint32_t)) {
+            site.literal = __make_veneer(symbol, head, &site, &target);
+            if (site.literal == NULL) return false;
+            site.literal_in_pool = true;
+        }  // if
+
+        auto pc_offset = static_cast<int64_t>(__intval(target) - __intval(symbol)) >> 2;
+        skyline::inlinehook::ControlledPages control(symbol, sizeof(uint32_t));
+        control.claim();
+        __atomic_store_n(static_cast<uint32_t*>(control.rw), 0x14000000u | (pc_offset & mask), __ATOMIC_RELEASE);
+        control.unclaim();
+    }  // if
+
+    site.head = head;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+
+// puts the patch back into the symbol or restores the original instructions. the patch is saved as it is when
+// removed, so reapplying it also brings back whatever head it pointed at
+static void __apply_site(void* const symbol, HookSite& site, bool apply) {
+    if (site.applied == apply) return;
+
+    skyline::inlinehook::ControlledPages control(symbol, site.patch_size);
+    control.claim();
+
+    auto rwsymbol = static_cast<uint32_t*>(control.rw);
+    if (!apply) memcpy(site.patched, rwsymbol, site.patch_size);
+    const uint32_t* source = apply ? site.patched : site.backup;
+
+    // a single B is swapped atomically, the LDR/BR sequence can't be
+    if (site.patch_size == sizeof(uint32_t))
+        __atomic_store_n(rwsymbol, source[0], __ATOMIC_RELEASE);
+    else
+        memcpy(rwsymbol, source, site.patch_size);
+
+    control.unclaim();
+    site.applied = apply;
+}
+
+//-------------------------------------------------------------------------
+
+// rewires every subscriber's result to the next enabled one in line, then points the symbol at the first. a site
+// with nothing enabled gets its original instructions back, so disabled hooks cost nothing
+static bool __relink_site(void* const symbol, HookSite& site) {
+    // results are updated before the head moves, so a subscriber is never reachable before it can pass the call on.
+    // disabled subscribers keep passing calls on too, in case one is still running
+    void* const base = site.prefix_enabled ? site.prefix : site.original;
+    void* head = base;
+    for (size_t i = site.subscribers.size(); i-- > 0;) {
+        HookSubscriber& subscriber = site.subscribers[i];
+        if (subscriber.result != NULL) *subscriber.result = head;
+        if (subscriber.enabled) head = subscriber.replace;
+    }
+
+    // a site with an enabled prefix but no subscribers dispatches straight to the prefix
+    if (head == site.original) {
+        __apply_site(symbol, site, false);
+        return true;
+    }  // if
+
+    __apply_site(symbol, site, true);
+    if (head == site.head) return true;
+    return __retarget_site(symbol, site, head);
+}
+
+//-------------------------------------------------------------------------
+
+// records a freshly patched symbol as a site with a single subscriber
+static HookHandle __register_site(void* const symbol, HookSite& site, void* const replace, void** result,
+                                  s32 priority, void* const rxtrampoline, HookHandle reserved) {
+    HookHandle handle = __take_handle(reserved);
+
+    site.original = rxtrampoline;
+    site.head = replace;
+    site.subscribers.push_back({replace, result, priority, handle, true, NULL, NULL});
+    if (result != NULL) *result = rxtrampoline;
+
+    __hook_sites.emplace(__uintval(symbol), std::move(site));
+    __hook_handles.emplace(handle, __uintval(symbol));
+    return handle;
+}
+
+//-------------------------------------------------------------------------
+
+// adds a subscriber to a symbol, installing the site if it isn't hooked yet. the caller holds hookMutex and flushes
+// the trampoline pool
+static HookHandle __subscribe_locked(void* const symbol, void* const replace, void** result, s32 priority,
+                                     HookHandle reserved = 0) {
+    auto it = __hook_sites.find(__uintval(symbol));
+    if (it == __hook_sites.end()) {
+        HookSite site = {};
+        void* const target = __branch_target(symbol, replace, &site);
+
+        skyline::inlinehook::Trampoline trampoline;
+        if (!__reserve_trampoline(symbol, A64_MAX_TRAMPOLINE_SIZE, &trampoline)) {
+            __release_allocations(site);
+            if (result != NULL) *result = NULL;
+            return 0;
+        }  // if
+
+        skyline::inlinehook::ControlledPages control(symbol, __hook_patch_size(symbol, target));
+        control.claim();
+
+        void* rxtrampoline;
+        Result rc = __install_site_claimed(site, symbol, static_cast<uint32_t*>(control.rw), target, trampoline, 0,
+                                           &rxtrampoline);
+        HookHandle handle = 0;
+        if (R_SUCCEEDED(rc))
+            handle = __register_site(symbol, site, replace, result, priority, rxtrampoline, reserved);
+        else if (result != NULL)
+            *result = NULL;
+
+        // result is set before the patch becomes visible
+        control.unclaim();
+        return handle;
+    }  // if
+
+    // higher priorities run first, the newest hook runs first among equals
+    HookSite& site = it->second;
+    HookHandle handle = __take_handle(reserved);
+    auto position = std::find_if(site.subscribers.begin(), site.subscribers.end(),
+                                 [priority](const HookSubscriber& s) { return s.priority <= priority; });
+    size_t index = position - site.subscribers.begin();
+    site.subscribers.insert(position, {replace, result, priority, handle, true, NULL, NULL});
+
+    if (!__relink_site(symbol, site)) {
+        skyline::logger::s_Instance->LogFormat("[And64InlineHook] failed to chain %p in front of %p", replace,
+                                               site.head);
+        site.subscribers.erase(site.subscribers.begin() + index);
+        __relink_site(symbol, site);
+        if (result != NULL) *result = NULL;
+        return 0;
+    }  // if
+
+    __hook_handles.emplace(handle, __uintval(symbol));
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] %p->%p chained, %zu hooks on this symbol", symbol,
+                                           replace, site.subscribers.size());
+    return handle;
+}
+
+//-------------------------------------------------------------------------
+
+// writes a time probe into thunk which continues through the pointer at target, returning its entry
+static void* __emit_stats_thunk(const skyline::inlinehook::Trampoline& thunk, uintptr_t stats, void** target) {
+    uint32_t* rw = thunk.rw;
+    uint32_t* rx = thunk.rx;
+    size_t entry_offset = __emit_time_probe(rw, rx, stats);
+    rw[14] = __encode_ldr_literal(17, rx + 14, rx + 18);  // LDR X17, target
+    rw[15] = 0xf9400231u;                                 // LDR X17, [X17]
+    rw[16] = 0xd61f0220u;                                 // BR X17
+    rw[17] = A64_NOP;                                     // keeps the literal 8-byte aligned
+    *reinterpret_cast<void***>(rw + 18) = target;
+    return rx + entry_offset / sizeof(uint32_t);
+}
+
+static void __release_hook_stats(HookStatsSlot* slot) {
+    for (auto& thunk : slot->thunks) skyline::inlinehook::TrampolinePool::release(&thunk);
+    if (slot->handle != 0) __attached_hook_stats.erase(slot->handle);
+    *slot = {};
+    __free_hook_stats.push_back(slot);
+}
+
+// takes a free stats slot and builds its probes, or returns NULL if stats can't be kept for this hook. result_entry
+// is only built if given, the caller flushes the trampoline pool
+static HookStatsSlot* __make_hook_stats(void* const symbol, void* const replace, void** replace_entry,
+                                        void** result_entry) {
+    if (R_FAILED(skyline::inlinehook::TimeProbes::initialize())) return NULL;
+
+    HookStatsSlot* slot;
+    if (!__free_hook_stats.empty()) {
+        slot = __free_hook_stats.back();
+        __free_hook_stats.pop_back();
+    } else if (__hook_stats_used < A64_MAX_HOOK_STATS) {
+        slot = &__hook_stats[__hook_stats_used++];
+    } else {
+        skyline::logger::s_Instance->LogFormat("[And64InlineHook] out of stats slots, %p is not timed", symbol);
+        return NULL;
+    }  // if
+
+    for (size_t i = 0; i < (result_entry != NULL ? 2u : 1u); i++) {
+        if (!__reserve_trampoline(symbol, A64_STATS_THUNK_SIZE, &slot->thunks[i])) {
+            __release_hook_stats(slot);
+            return NULL;
+        }  // if
+    }
+
+    slot->symbol = symbol;
+    slot->replace = replace;
+    slot->time = {0, 0, UINT64_MAX, 0};
+    uintptr_t time = __uintval(&slot->time) | TIME_PROBE_EXCLUSIVE;
+    *replace_entry = __emit_stats_thunk(slot->thunks[0], time, &slot->replace);
+    if (result_entry != NULL) *result_entry = __emit_stats_thunk(slot->thunks[1], 0, &slot->next);
+    return slot;
+}
+
+static void __attach_hook_stats(void* const symbol, HookHandle handle, HookStatsSlot* slot) {
+    slot->handle = handle;
+    __attached_hook_stats.emplace(handle, slot);
+    for (auto& subscriber : __hook_sites[__uintval(symbol)].subscribers) {
+        if (subscriber.handle == handle) subscriber.stats = slot;
+    }
+}
+
+// __subscribe_locked, timing the replacement while stats are enabled
+static HookHandle __subscribe_timed_locked(void* const symbol, void* const replace, void** result, s32 priority,
+                                           HookHandle reserved = 0) {
+    void* replace_entry;
+    void* result_entry;
+    HookStatsSlot* slot = NULL;
+    if (__hook_stats_enabled)
+        slot = __make_hook_stats(symbol, replace, &replace_entry, result != NULL ? &result_entry : NULL);
+    if (slot == NULL) return __subscribe_locked(symbol, replace, result, priority, reserved);
+
+    // the replacement is handed the result probe, which passes the call on to whatever the chain puts in slot->next
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+    if (result != NULL) *result = result_entry;
+
+    HookHandle handle =
+        __subscribe_locked(symbol, replace_entry, result != NULL ? &slot->next : NULL, priority, reserved);
+    if (handle == 0) {
+        __release_hook_stats(slot);
+        if (result != NULL) *result = NULL;
+        return 0;
+    }  // if
+
+    __attach_hook_stats(symbol, handle, slot);
+    return handle;
+}
+
+//-------------------------------------------------------------------------
+
+// counts hooks installed by one call to the public API, failed ones included
+static void __add_install_time(u64 start, size_t hooks) {
+    skyline::inlinehook::InstallStats::add(skyline::inlinehook::InstallPhase_Total, armGetSystemTick() - start);
+    skyline::inlinehook::InstallStats::addHooks(hooks);
+}
+
+extern "C" HookHandle A64HookFunction(void* const symbol, void* const replace, void** result) {
+    return A64HookFunctionPriority(symbol, replace, result, 0);
+}
+
+extern "C" HookHandle A64HookFunctionPriority(void* const symbol, void* const replace, void** result, s32 priority) {
+    nn::os::LockMutex(&hookMutex);
+    u64 start = armGetSystemTick();
+
+    HookHandle handle = __subscribe_timed_locked(symbol, replace, result, priority);
+
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    __add_install_time(start, 1);
+    nn::os::UnlockMutex(&hookMutex);
+    return handle;
+}
+
+//-------------------------------------------------------------------------
+
+// installs a batch, taking the handles from reserved if given
+static void __hook_batch(const HookSpec* specs, const HookHandle* reserved, size_t count) {
+    if (specs == NULL || count == 0) return;
+
+    // visit the hooks in address order, so that every run of hooks sharing a page is patched through one claim.
+    // the sort is stable, hooks on the same symbol are applied in the order they were passed in
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [specs](size_t a, size_t b) { return __uintval(specs[a].symbol) < __uintval(specs[b].symbol); });
+
+    nn::os::LockMutex(&hookMutex);
+    u64 start = armGetSystemTick();
+
+    // symbols that are already hooked, or hooked earlier in this batch, only need to be chained
+    std::vector<size_t> fresh, chained;
+    for (size_t k = 0; k < count; k++) {
+        const HookSpec& spec = specs[order[k]];
+        bool seen = k != 0 && specs[order[k - 1]].symbol == spec.symbol;
+        if (seen || __hook_sites.count(__uintval(spec.symbol)) != 0)
+            chained.push_back(order[k]);
+        else
+            fresh.push_back(order[k]);
+    }
+
+    // while stats are enabled, fresh hooks are installed on their probes like in __subscribe_timed_locked
+    std::vector<HookSite> sites(count);
+    std::vector<void*> targets(count), replaces(count);
+    std::vector<HookStatsSlot*> stats(count);
+    for (size_t i : fresh) {
+        void* result_entry = NULL;
+        replaces[i] = specs[i].replace;
+        if (__hook_stats_enabled) {
+            stats[i] = __make_hook_stats(specs[i].symbol, specs[i].replace, &replaces[i],
+                                         specs[i].result != NULL ? &result_entry : NULL);
+        }  // if
+        if (stats[i] != NULL && specs[i].result != NULL) *specs[i].result = result_entry;
+        targets[i] = __branch_target(specs[i].symbol, replaces[i], &sites[i]);
+    }
+    if (__hook_stats_enabled) R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    size_t claimed_pages = 0;
+
+    for (size_t group_start = 0; group_start < fresh.size();) {
+        // extend the group while the next hook starts on a page that is already covered
+        uintptr_t page_start = __align_down(__uintval(specs[fresh[group_start]].symbol), __page_size);
+        uintptr_t page_end = 0;
+        size_t group_end = group_start;
+        for (; group_end < fresh.size(); group_end++) {
+            const HookSpec& spec = specs[fresh[group_end]];
+            uintptr_t symbol = __uintval(spec.symbol);
+            if (group_end != group_start && __align_down(symbol, __page_size) >= page_end) break;
+            uintptr_t patch_size = __hook_patch_size(spec.symbol, targets[fresh[group_end]]);
+            page_end = MAX(page_end, __page_align(symbol + patch_size));
+        }
+
+        skyline::inlinehook::ControlledPages control(__ptr(page_start), page_end - page_start);
+        control.claim();
+        claimed_pages += (page_end - page_start) / __page_size;
+
+        for (size_t i = group_start; i < group_end; i++) {
+            const HookSpec& spec = specs[fresh[i]];
+
+            HookSite& site = sites[fresh[i]];
+            if (spec.handle != NULL) *spec.handle = 0;
+
+            HookStatsSlot* slot = stats[fresh[i]];
+            skyline::inlinehook::Trampoline trampoline;
+            if (!__reserve_trampoline(spec.symbol, A64_MAX_TRAMPOLINE_SIZE, &trampoline)) {
+                __release_allocations(site);
+                if (slot != NULL) __release_hook_stats(slot);
+                if (spec.result != NULL) *spec.result = NULL;
+                continue;
+            }  // if
+
+            uint32_t* rwsymbol = reinterpret_cast<uint32_t*>(__uintval(control.rw) + __uintval(spec.symbol) -
+                                                             __uintval(control.rx));
+            void* rxtrampoline;
+            if (R_FAILED(__install_site_claimed(site, spec.symbol, rwsymbol, targets[fresh[i]], trampoline, 0,
+                                                &rxtrampoline))) {
+                if (slot != NULL) __release_hook_stats(slot);
+                if (spec.result != NULL) *spec.result = NULL;
+                continue;
+            }  // if
+
+            void** result = slot != NULL && spec.result != NULL ? &slot->next : spec.result;
+            HookHandle handle = __register_site(spec.symbol, site, replaces[fresh[i]], result, spec.priority,
+                                                rxtrampoline, reserved != NULL ? reserved[fresh[i]] : 0);
+            if (slot != NULL) __attach_hook_stats(spec.symbol, handle, slot);
+            if (spec.handle != NULL) *spec.handle = handle;
+        }
+
+        // flushes every symbol patched in this group
+        control.unclaim();
+        group_start = group_end;
+    }
+
+    // chaining goes through the same pages again, but only touches a literal or a single branch per hook
+    std::sort(chained.begin(), chained.end());
+    for (size_t i : chained) {
+        HookHandle handle = __subscribe_timed_locked(specs[i].symbol, specs[i].replace, specs[i].result,
+                                                     specs[i].priority, reserved != NULL ? reserved[i] : 0);
+        if (specs[i].handle != NULL) *specs[i].handle = handle;
+    }
+
+    // one cache flush and JIT transition for every trampoline written by this batch
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    __add_install_time(start, count);
+    nn::os::UnlockMutex(&hookMutex);
+
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] batch installed %zu hooks over %zu pages", count,
+                                           claimed_pages);
+}
+
+extern "C" void A64HookFunctionBatch(const HookSpec* specs, size_t count) { __hook_batch(specs, NULL, count); }
+
+void A64HookFunctionBatchReserved(const HookSpec* specs, const HookHandle* handles, size_t count) {
+    __hook_batch(specs, handles, count);
+}
+
+HookHandle A64HookReserveHandle() {
     nn::os::LockMutex(&hookMutex);
+    HookHandle handle = __next_hook_handle++;
+    nn::os::UnlockMutex(&hookMutex);
+    return handle;
+}
+
+//-------------------------------------------------------------------------
+
+// ops are kept short so a patch fits a single trampoline reservation next to the relocated prologue
+#define A64_MAX_PATCH_OPS 16
+#define A64_MAX_PATCH_OP_INSTRUCTIONS 14
+
+static uint32_t* __emit_mov_imm(uint32_t* out, uint32_t rd, uint64_t value) {
+    *out++ = 0xd2800000u | ((value & 0xffffu) << 5) | rd;  // MOVZ Xd, #imm16
+    for (uint32_t hw = 1; hw < 4; hw++) {
+        uint32_t imm16 = (value >> (hw * 16)) & 0xffffu;
+        if (imm16 != 0) *out++ = 0xf2800000u | (hw << 21) | (imm16 << 5) | rd;  // MOVK Xd, #imm16, LSL #(hw * 16)
+    }
+    return out;
+}
+
+// clamps rd against x16 using cond (LT for a lower bound, GT for an upper one), x16 must hold the bound
+static uint32_t* __emit_clamp(uint32_t* out, uint32_t rd, uint32_t cond) {
+    *out++ = 0xeb10001fu | (rd << 5);                       // CMP Xd, X16
+    *out++ = 0x9a800200u | (rd << 16) | (cond << 12) | rd;  // CSEL Xd, X16, Xd, cond
+    return out;
+}
+
+// compiles a single op, x16 and x17 are free to use as they are already clobbered by the hook sequences
+static uint32_t* __emit_patch_op(uint32_t* out, const InlinePatchOp& op) {
+    switch (op.type) {
+        case InlinePatchOp::Set:
+            return __emit_mov_imm(out, op.reg, op.value);
+        case InlinePatchOp::Copy:
+            *out++ = 0xaa0003e0u | (static_cast<uint32_t>(op.value) << 16) | op.reg;  // MOV Xd, Xm
+            return out;
+        case InlinePatchOp::Add:
+            out = __emit_mov_imm(out, 16, op.value);
+            *out++ = 0x8b100000u | (op.reg << 5) | op.reg;  // ADD Xd, Xd, X16
+            return out;
+        case InlinePatchOp::Clamp:
+            // the comparisons must not leak into the flags of the hooked code
+            *out++ = 0xd53b4211u;  // MRS X17, NZCV
+            out = __emit_mov_imm(out, 16, op.value);
+            out = __emit_clamp(out, op.reg, 0xb);  // LT
+            out = __emit_mov_imm(out, 16, op.max);
+            out = __emit_clamp(out, op.reg, 0xc);  // GT
+            *out++ = 0xd51b4211u;                  // MSR NZCV, X17
+            return out;
+    }  // switch
+    return out;
+}
+
+static bool __valid_patch_op(const InlinePatchOp& op) {
+    // x16/x17 are scratch, and x18 is reserved by the platform
+    auto usable = [](u64 reg) { return reg < 31 && (reg < 16 || reg > 18); };
+    if (!usable(op.reg)) return false;
+    switch (op.type) {
+        case InlinePatchOp::Set:
+        case InlinePatchOp::Add:
+            return true;
+        case InlinePatchOp::Copy:
+            return usable(op.value);
+        case InlinePatchOp::Clamp:
+            return static_cast<s64>(op.value) <= static_cast<s64>(op.max);
+    }  // switch
+    return false;
+}
 
-    R_ERRORONFAIL(jitTransitionToWritable(&__insns_jit));
+//-------------------------------------------------------------------------
 
-    uint32_t *rxtrampoline = NULL, *rwtrampoline = NULL;
-    if (result != NULL) {
-        FastAllocateTrampoline(&rxtrampoline, &rwtrampoline);
-        *result = rxtrampoline;
-        if (rxtrampoline == NULL) {
-            *(u64*)rxtrampoline = 0;
-            return;
-        };
+// installs a site whose original is code emitted in front of the relocated prologue, laid out as
+// [prefix][relocated prologue][branch back]. emit writes at most max_size bytes of prefix through rw, which executes
+// at rx, and returns how many it wrote along with the offset the symbol should enter at. the prefix gets a handle of
+// its own, the caller holds hookMutex
+template <typename Emit>
+static Result __install_prefixed_locked(void* const address, size_t max_size, HookHandle* handle, Emit emit) {
+    // the prefix becomes the original of its site, so it has to be in place before any hook is chained on top
+    if (__hook_sites.count(__uintval(address)) != 0) {
+        skyline::logger::s_Instance->LogFormat("[And64InlineHook] cannot prefix %p, it is already hooked", address);
+        return MAKERESULT(Module_Skyline, SkylineError_InlinePatchInvalid);
     }  // if
 
-    rxtrampoline =
-        (uint32_t*)A64HookFunctionV(symbol, replace, rxtrampoline, rwtrampoline, A64_MAX_INSTRUCTIONS * 10u);
-    if (rxtrampoline == NULL && result != NULL) {
-        *result = NULL;
+    skyline::inlinehook::Trampoline trampoline;
+    if (!__reserve_trampoline(address, max_size + A64_MAX_TRAMPOLINE_SIZE, &trampoline))
+        return MAKERESULT(Module_Skyline, SkylineError_TrampolineTooLarge);
+
+    size_t entry_offset = 0;
+    const size_t prefix_size = emit(trampoline.rw, trampoline.rx, &entry_offset);
+    void* const entry = trampoline.rx + entry_offset / sizeof(uint32_t);
+
+    HookSite site = {};
+    void* const target = __branch_target(address, entry, &site);
+
+    skyline::inlinehook::ControlledPages control(address, __hook_patch_size(address, target));
+    control.claim();
+
+    void* rxtrampoline;
+    Result rc = __install_site_claimed(site, address, static_cast<uint32_t*>(control.rw), target, trampoline,
+                                       prefix_size, &rxtrampoline);
+
+    // later hooks on this address call through the prefix, as if it was part of the original code
+    if (R_SUCCEEDED(rc)) {
+        site.original = rxtrampoline;
+        site.head = entry;
+        site.prefix = entry;
+        site.prefix_handle = __next_hook_handle++;
+        site.prefix_enabled = true;
+        __hook_handles.emplace(site.prefix_handle, __uintval(address));
+        if (handle != NULL) *handle = site.prefix_handle;
+        __hook_sites.emplace(__uintval(address), std::move(site));
+    }  // if
+
+    control.unclaim();
+    return rc;
+}
+
+//-------------------------------------------------------------------------
+
+extern "C" Result A64InlinePatch(void* const address, const InlinePatchOp* ops, size_t count, HookHandle* handle) {
+    if (handle != NULL) *handle = 0;
+    R_UNLESS(ops != NULL && count != 0 && count <= A64_MAX_PATCH_OPS,
+             MAKERESULT(Module_Skyline, SkylineError_InlinePatchInvalid));
+    for (size_t i = 0; i < count; i++)
+        R_UNLESS(__valid_patch_op(ops[i]), MAKERESULT(Module_Skyline, SkylineError_InlinePatchInvalid));
+
+    nn::os::LockMutex(&hookMutex);
+
+    size_t ops_size = 0;
+    Result rc = __install_prefixed_locked(
+        address, count * A64_MAX_PATCH_OP_INSTRUCTIONS * sizeof(uint32_t), handle,
+        [&](uint32_t* rw, uint32_t*, size_t* entry_offset) {
+            uint32_t* out = rw;
+            for (size_t i = 0; i < count; i++) out = __emit_patch_op(out, ops[i]);
+            *entry_offset = 0;
+            return ops_size = (out - rw) * sizeof(uint32_t);
+        });
+
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    nn::os::UnlockMutex(&hookMutex);
+
+    R_TRY(rc);
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] patched %p with %zu ops (%zu bytes)", address, count,
+                                           ops_size);
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+
+// the count and time probes, for A64HookDumpProbes. an entry goes when its probe is removed
+struct ProbeEntry {
+    HookHandle handle;
+    void* symbol;
+    u64* counter;         // set for a count probe
+    HookTimeStats* time;  // set for a time probe
+};
+
+static std::vector<ProbeEntry> __probes;
+
+extern "C" Result A64CountHook(void* const symbol, u64* counter, HookHandle* handle) {
+    if (handle != NULL) *handle = 0;
+    R_UNLESS(counter != NULL, MAKERESULT(Module_Skyline, SkylineError_InlinePatchInvalid));
+
+    nn::os::LockMutex(&hookMutex);
+
+    auto emit = [&](uint32_t* rw, uint32_t* rx, size_t* entry_offset) {
+        *reinterpret_cast<u64**>(rw) = counter;
+        rw[2] = __encode_ldr_literal(16, rx + 2, rx);  // LDR X16, counter
+        rw[3] = 0xf81f0fefu;                           // STR X15, [SP, #-16]!
+        rw[4] = 0xc85f7e11u;                           // LDXR X17, [X16]
+        rw[5] = 0x91000631u;                           // ADD X17, X17, #1
+        rw[6] = 0xc80f7e11u;                           // STXR W15, X17, [X16]
+        rw[7] = 0x35ffffafu;                           // CBNZ W15, #-12
+        rw[8] = 0xf84107efu;                           // LDR X15, [SP], #16
+        *entry_offset = 2 * sizeof(uint32_t);
+        return 9 * sizeof(uint32_t);
+    };
+    HookHandle probe = 0;
+    Result rc = __install_prefixed_locked(symbol, 10 * sizeof(uint32_t), &probe, emit);
+    if (R_SUCCEEDED(rc)) __probes.push_back({probe, symbol, counter, NULL});
+
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    nn::os::UnlockMutex(&hookMutex);
+    if (handle != NULL) *handle = probe;
+    return rc;
+}
+
+// puts a time probe block recording into stats in front of symbol, the caller holds hookMutex and flushes
+static Result __install_time_probe_locked(void* const symbol, uintptr_t stats, HookHandle* handle) {
+    R_TRY(skyline::inlinehook::TimeProbes::initialize());
+
+    auto emit = [&](uint32_t* rw, uint32_t* rx, size_t* entry_offset) {
+        *entry_offset = __emit_time_probe(rw, rx, stats);
+        return A64_TIME_PROBE_SIZE;
+    };
+    return __install_prefixed_locked(symbol, A64_TIME_PROBE_SIZE, handle, emit);
+}
+
+extern "C" Result A64TimeHook(void* const symbol, HookTimeStats* stats, HookHandle* handle) {
+    if (handle != NULL) *handle = 0;
+    R_UNLESS(stats != NULL, MAKERESULT(Module_Skyline, SkylineError_InlinePatchInvalid));
+    *stats = {0, 0, UINT64_MAX, 0};
+
+    nn::os::LockMutex(&hookMutex);
+
+    HookHandle probe = 0;
+    Result rc = __install_time_probe_locked(symbol, __uintval(stats), &probe);
+    if (R_SUCCEEDED(rc)) __probes.push_back({probe, symbol, NULL, stats});
+
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    nn::os::UnlockMutex(&hookMutex);
+    if (handle != NULL) *handle = probe;
+    return rc;
+}
+
+extern "C" Result A64TraceHook(void* const symbol, const char* name, HookHandle* handle) {
+    if (handle != NULL) *handle = 0;
+    nn::os::LockMutex(&hookMutex);
+
+    u32 id;
+    Result rc = skyline::inlinehook::TraceRings::initialize();
+    if (R_SUCCEEDED(rc)) rc = skyline::inlinehook::TraceRings::registerName(name, &id);
+    if (R_SUCCEEDED(rc)) {
+        rc = __install_time_probe_locked(
+            symbol, (static_cast<uintptr_t>(id) << TIME_PROBE_TRACE_SHIFT) | TIME_PROBE_TRACE, handle);
     }  // if
 
-    R_ERRORONFAIL(jitTransitionToExecutable(&__insns_jit));
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
 
     nn::os::UnlockMutex(&hookMutex);
+    return rc;
 }
 
 extern const void (*inlineHandlerStart)(void);
 extern const void* inlineHandlerEnd;
 extern const void (*inlineHandlerImpl)(void);
+extern const void (*inlineHandlerMinimalImpl)(void);
+extern const void (*inlineHandlerFpImpl)(void);
+
+// an inline hook's entry, placed in the trampoline pool near the hooked address, and the slot its handler continues
+// through. the slot is kept out of the JIT so chaining can update it like any other result
+struct InlineHookState {
+    skyline::inlinehook::Trampoline entry;
+    void* trampoline;
+};
+
+// states of removed inline hooks. a thread may still be inside the handler, loading from the entry and continuing
+// through the slot, or may have loaded the entry from a result just before the site was relinked. a state is only
+// given back to the trampoline pool and the heap by a later install or removal, once it has been retired for
+// A64_INLINE_RETIRE_GRACE_NS, so callbacks must not stay inside an inline hook that long after it is removed
+#define A64_INLINE_RETIRE_GRACE_NS 1000000000ull
+struct RetiredInlineState {
+    InlineHookState* state;
+    u64 retired_tick;
+};
+static std::vector<RetiredInlineState> __retired_inline_states;
+
+// frees retired states whose grace period is over, the caller holds hookMutex and flushes the trampoline pool
+static void __drain_retired_inline_states() {
+    const u64 now = armGetSystemTick();
+    const u64 grace = armNsToTicks(A64_INLINE_RETIRE_GRACE_NS);
+    auto expired = [now, grace](const RetiredInlineState& retired) {
+        if (now - retired.retired_tick < grace) return false;
+        skyline::inlinehook::TrampolinePool::release(&retired.state->entry);
+        delete retired.state;
+        return true;
+    };
+    __retired_inline_states.erase(
+        std::remove_if(__retired_inline_states.begin(), __retired_inline_states.end(), expired),
+        __retired_inline_states.end());
+}
+
+// picks the cheapest handler that still exposes every register the callback asked for
+static const void* __inline_handler_for(u64 reg_mask) {
+    if (reg_mask & A64_INLINE_REGS_FPU) return &inlineHandlerFpImpl;
+    if (reg_mask & ~A64_INLINE_REGS_CALLER_SAVED) return &inlineHandlerImpl;
+    return &inlineHandlerMinimalImpl;
+}
 
-u64 inline_hook_curridx = 0;
+extern "C" HookHandle A64InlineHook(void* const address, void* const callback) {
+    return A64InlineHookEx(address, callback, A64_INLINE_REGS_ALL);
+}
 
-extern "C" void A64InlineHook(void* const address, void* const callback) {
+extern "C" HookHandle A64InlineHookEx(void* const address, void* const callback, u64 reg_mask) {
     u64 handler_start_addr = (u64)&inlineHandlerStart;
     u64 handler_end_addr = (u64)&inlineHandlerEnd;
 
@@ -684,35 +1115,297 @@ extern "C" void A64InlineHook(void* const address, void* const callback) {
         R_ERRORONFAIL(MAKERESULT(Module_Skyline, SkylineError_InlineHookHandlerSizeInvalid));
     }
 
-    // check pool availability
-    if (inline_hook_curridx >= inline_hook_count) {
-        skyline::logger::s_Instance->LogFormat("[A64InlineHook] inline hook pool exausted");
-        R_ERRORONFAIL(MAKERESULT(Module_Skyline, SkylineError_InlineHookPoolExhausted));
-    }
+    nn::os::LockMutex(&hookMutex);
+    u64 start = armGetSystemTick();
+    __drain_retired_inline_states();
+
+    auto state = new InlineHookState();
+    if (!__reserve_trampoline(address, sizeof(inline_hook_entry), &state->entry)) {
+        delete state;
+        __add_install_time(start, 1);
+        nn::os::UnlockMutex(&hookMutex);
+        return 0;
+    }  // if
+
+    // while stats are enabled the handler calls the callback through its probe
+    void* timed_callback = callback;
+    HookStatsSlot* slot = __hook_stats_enabled ? __make_hook_stats(address, callback, &timed_callback, NULL) : NULL;
 
-    // prepare to hook
-    jitTransitionToExecutable(&__inline_hook_jit);
-    auto& rx_entries = *reinterpret_cast<std::array<inline_hook_entry, inline_hook_count>*>(__inline_hook_jit.rx_addr);
-    auto& rx = rx_entries[inline_hook_curridx];
+    // populate handler entry, and make it executable before anything can branch to it
+    auto& rw = *reinterpret_cast<inline_hook_entry*>(state->entry.rw);
+    memcpy(rw.handler.data(), (void*)handler_start_addr, inline_hook_handler_size);
+    rw.cur_handler = __inline_handler_for(reg_mask);
+    rw.callback = timed_callback;
+    rw.trampoline = &state->trampoline;
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
 
     // hook to call the handler
-    void* trampoline;
-    A64HookFunction(address, &rx.handler, &trampoline);
+    auto& rx = *reinterpret_cast<inline_hook_entry*>(state->entry.rx);
+    HookHandle handle = __subscribe_locked(address, rx.handler.data(), &state->trampoline, 0);
+    if (handle != 0) {
+        HookSite& site = __hook_sites[__uintval(address)];
+        for (auto& subscriber : site.subscribers) {
+            if (subscriber.handle == handle) subscriber.inline_state = state;
+        }
+        if (slot != NULL) __attach_hook_stats(address, handle, slot);
+    } else {
+        if (slot != NULL) __release_hook_stats(slot);
+        skyline::inlinehook::TrampolinePool::release(&state->entry);
+        delete state;
+    }  // if
 
-    // populate handler entry
-    jitTransitionToWritable(&__inline_hook_jit);
-    auto& rw_entries = *reinterpret_cast<std::array<inline_hook_entry, inline_hook_count>*>(__inline_hook_jit.rw_addr);
-    auto& rw = rw_entries[inline_hook_curridx];
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
 
-    memcpy(rw.handler.data(), (void*)handler_start_addr, inline_hook_handler_size);
-    rw.cur_handler = &inlineHandlerImpl;
-    rw.callback = callback;
-    rw.trampoline = trampoline;
+    __add_install_time(start, 1);
+    nn::os::UnlockMutex(&hookMutex);
+    return handle;
+}
+
+//-------------------------------------------------------------------------
+
+// looks up the site of a handle along with its subscriber, which is left NULL for the site's prefix. the caller
+// holds hookMutex
+static bool __find_hook(HookHandle handle, uintptr_t* symbol, HookSite** site, HookSubscriber** subscriber) {
+    auto it = __hook_handles.find(handle);
+    if (it == __hook_handles.end()) return false;
+
+    *symbol = it->second;
+    *site = &__hook_sites[it->second];
+    *subscriber = NULL;
+    if ((*site)->prefix_handle == handle) return true;
+    for (auto& s : (*site)->subscribers) {
+        if (s.handle == handle) *subscriber = &s;
+    }
+    return *subscriber != NULL;
+}
+
+static Result __set_installed_enabled(HookHandle handle, bool enabled) {
+    nn::os::LockMutex(&hookMutex);
+
+    uintptr_t symbol;
+    HookSite* site;
+    HookSubscriber* subscriber;
+    if (!__find_hook(handle, &symbol, &site, &subscriber)) {
+        nn::os::UnlockMutex(&hookMutex);
+        return MAKERESULT(Module_Skyline, SkylineError_InvalidHookHandle);
+    }  // if
+
+    Result rc = 0;
+    bool& current = subscriber != NULL ? subscriber->enabled : site->prefix_enabled;
+    if (current != enabled) {
+        current = enabled;
+        if (!__relink_site(__ptr(symbol), *site)) {
+            current = !enabled;
+            __relink_site(__ptr(symbol), *site);
+            rc = MAKERESULT(Module_Skyline, SkylineError_TrampolineTooLarge);
+        }  // if
+    }  // if
+
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    nn::os::UnlockMutex(&hookMutex);
+    return rc;
+}
+
+// handles of deferred hooks are handed out before the hook is installed. one that isn't installed yet may still be
+// queued, or have been installed in between, in which case looking it up again finds it
+static Result __set_enabled(HookHandle handle, bool enabled) {
+    Result rc = __set_installed_enabled(handle, enabled);
+    if (rc != MAKERESULT(Module_Skyline, SkylineError_InvalidHookHandle)) return rc;
+    if (skyline::inlinehook::DeferredHooks::setEnabled(handle, enabled)) return 0;
+    return __set_installed_enabled(handle, enabled);
+}
+
+extern "C" Result A64HookDisable(HookHandle handle) { return __set_enabled(handle, false); }
+
+extern "C" Result A64HookEnable(HookHandle handle) { return __set_enabled(handle, true); }
+
+static Result __remove_installed(HookHandle handle) {
+    nn::os::LockMutex(&hookMutex);
+
+    uintptr_t symbol;
+    HookSite* site;
+    HookSubscriber* subscriber;
+    if (!__find_hook(handle, &symbol, &site, &subscriber)) {
+        nn::os::UnlockMutex(&hookMutex);
+        return MAKERESULT(Module_Skyline, SkylineError_InvalidHookHandle);
+    }  // if
+
+    if (subscriber != NULL) {
+        if (subscriber->inline_state != NULL)
+            __retired_inline_states.push_back({subscriber->inline_state, armGetSystemTick()});
+        if (subscriber->stats != NULL) __release_hook_stats(subscriber->stats);
+        site->subscribers.erase(site->subscribers.begin() + (subscriber - site->subscribers.data()));
+    } else {
+        // the relocated prologue behind the prefix stays in use until the site goes
+        site->prefix_handle = 0;
+        site->prefix_enabled = false;
+        __probes.erase(std::remove_if(__probes.begin(), __probes.end(),
+                                      [handle](const ProbeEntry& probe) { return probe.handle == handle; }),
+                       __probes.end());
+    }  // if
+    __hook_handles.erase(handle);
 
-    // finalize, make handler executable
-    jitTransitionToExecutable(&__inline_hook_jit);
+    // should the next head be out of reach, the site keeps entering the removed hook, whose result still passes on
+    if (!__relink_site(__ptr(symbol), *site))
+        skyline::logger::s_Instance->LogFormat("[And64InlineHook] failed to unlink hook from %p", __ptr(symbol));
 
-    inline_hook_curridx++;
+    // once the original instructions are back nothing can enter the site anymore
+    if (site->subscribers.empty() && site->prefix_handle == 0) {
+        __release_allocations(*site);
+        __hook_sites.erase(symbol);
+    }  // if
+    __drain_retired_inline_states();
+
+    R_ERRORONFAIL(skyline::inlinehook::TrampolinePool::flush());
+
+    nn::os::UnlockMutex(&hookMutex);
+
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] removed hook on %p", __ptr(symbol));
+    return 0;
+}
+
+extern "C" Result A64HookRemove(HookHandle handle) {
+    Result rc = __remove_installed(handle);
+    if (rc != MAKERESULT(Module_Skyline, SkylineError_InvalidHookHandle)) return rc;
+    if (skyline::inlinehook::DeferredHooks::cancel(handle)) return 0;
+    return __remove_installed(handle);
+}
+
+//-------------------------------------------------------------------------
+
+extern "C" void A64HookSetStatsEnabled(bool enabled) {
+    nn::os::LockMutex(&hookMutex);
+    __hook_stats_enabled = enabled;
+    nn::os::UnlockMutex(&hookMutex);
+}
+
+extern "C" size_t A64HookGetStats(HookStats* stats, size_t count) {
+    nn::os::LockMutex(&hookMutex);
+
+    // the probes keep counting while this runs, every field is read on its own
+    size_t written = 0;
+    for (auto& [handle, slot] : __attached_hook_stats) {
+        if (written == count) break;
+
+        HookStats& out = stats[written++];
+        out.handle = handle;
+        out.symbol = slot->symbol;
+        out.time.calls = __atomic_load_n(&slot->time.calls, __ATOMIC_RELAXED);
+        out.time.total_ticks = __atomic_load_n(&slot->time.total_ticks, __ATOMIC_RELAXED);
+        out.time.min_ticks = __atomic_load_n(&slot->time.min_ticks, __ATOMIC_RELAXED);
+        out.time.max_ticks = __atomic_load_n(&slot->time.max_ticks, __ATOMIC_RELAXED);
+    }
+
+    nn::os::UnlockMutex(&hookMutex);
+    return written;
+}
+
+extern "C" void A64HookDumpStats() {
+    static HookStats stats[A64_MAX_HOOK_STATS];
+    size_t count = A64HookGetStats(stats, A64_MAX_HOOK_STATS);
+
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] stats for %zu hooks:", count);
+    for (size_t i = 0; i < count; i++) {
+        const HookTimeStats& time = stats[i].time;
+        if (time.calls == 0) {
+            skyline::logger::s_Instance->LogFormat("  hook %lu on %p: never called", stats[i].handle, stats[i].symbol);
+            continue;
+        }  // if
+
+        skyline::logger::s_Instance->LogFormat(
+            "  hook %lu on %p: %lu calls, %lu ns total, %lu ns avg, %lu ns min, %lu ns max", stats[i].handle,
+            stats[i].symbol, time.calls, armTicksToNs(time.total_ticks), armTicksToNs(time.total_ticks / time.calls),
+            armTicksToNs(time.min_ticks), armTicksToNs(time.max_ticks));
+    }
+}
+
+extern "C" void A64HookDumpProbes() {
+    // the counters keep running while they are logged, only the list is copied under the lock
+    nn::os::LockMutex(&hookMutex);
+    std::vector<ProbeEntry> probes = __probes;
+    nn::os::UnlockMutex(&hookMutex);
+
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] %zu probes:", probes.size());
+    for (auto& probe : probes) {
+        if (probe.counter != NULL) {
+            skyline::logger::s_Instance->LogFormat("  count probe %lu on %p: %lu calls", probe.handle, probe.symbol,
+                                                   __atomic_load_n(probe.counter, __ATOMIC_RELAXED));
+            continue;
+        }  // if
+
+        HookTimeStats time;
+        time.calls = __atomic_load_n(&probe.time->calls, __ATOMIC_RELAXED);
+        time.total_ticks = __atomic_load_n(&probe.time->total_ticks, __ATOMIC_RELAXED);
+        time.min_ticks = __atomic_load_n(&probe.time->min_ticks, __ATOMIC_RELAXED);
+        time.max_ticks = __atomic_load_n(&probe.time->max_ticks, __ATOMIC_RELAXED);
+        if (time.calls == 0) {
+            skyline::logger::s_Instance->LogFormat("  time probe %lu on %p: never called", probe.handle, probe.symbol);
+            continue;
+        }  // if
+
+        skyline::logger::s_Instance->LogFormat(
+            "  time probe %lu on %p: %lu calls, %lu ns total, %lu ns avg, %lu ns min, %lu ns max", probe.handle,
+            probe.symbol, time.calls, armTicksToNs(time.total_ticks), armTicksToNs(time.total_ticks / time.calls),
+            armTicksToNs(time.min_ticks), armTicksToNs(time.max_ticks));
+    }
+}
+
+static void __stats_dump_main(void* arg) {
+    auto interval = nn::TimeSpan::FromNanoSeconds(reinterpret_cast<u64>(arg) * 1000000);
+    while (true) {
+        nn::os::SleepThread(interval);
+        A64HookDumpStats();
+        A64HookDumpProbes();
+    }
+}
+
+extern "C" void A64HookStartStatsDump(u64 interval_ms) {
+    // only the first call starts the thread, later ones keep its interval
+    static skyline::utils::Once s_started;
+    s_started.call_once([interval_ms] {
+        const size_t stackSize = 0x3000;
+        void* threadStack = memalign(0x1000, stackSize);
+
+        nn::os::ThreadType* thread = new nn::os::ThreadType;
+        nn::os::CreateThread(thread, __stats_dump_main, reinterpret_cast<void*>(interval_ms), threadStack, stackSize,
+                             16, 0);
+        nn::os::StartThread(thread);
+    });
+}
+
+//-------------------------------------------------------------------------
+
+extern "C" void A64HookGetInstallStats(HookInstallStats* stats) {
+    using namespace skyline::inlinehook;
+
+    stats->hooks = InstallStats::hooks();
+    stats->total_ticks = InstallStats::ticks(InstallPhase_Total);
+    stats->claim_ticks = InstallStats::ticks(InstallPhase_Claim);
+    stats->relocate_ticks = InstallStats::ticks(InstallPhase_Relocate);
+    stats->jit_ticks = InstallStats::ticks(InstallPhase_Jit);
+    stats->cache_ticks = InstallStats::ticks(InstallPhase_Cache);
+}
+
+extern "C" void A64HookResetInstallStats() { skyline::inlinehook::InstallStats::reset(); }
+
+extern "C" void A64HookDumpInstallStats() {
+    HookInstallStats stats;
+    A64HookGetInstallStats(&stats);
+
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] installed %lu hooks in %lu ns", stats.hooks,
+                                           armTicksToNs(stats.total_ticks));
+    if (stats.hooks == 0) return;
+
+    auto phase = [&](const char* name, u64 ticks) {
+        skyline::logger::s_Instance->LogFormat("  %-8s %lu ns per hook, %lu ns total", name,
+                                               armTicksToNs(ticks / stats.hooks), armTicksToNs(ticks));
+    };
+    phase("total", stats.total_ticks);
+    phase("claim", stats.claim_ticks);
+    phase("relocate", stats.relocate_ticks);
+    phase("jit", stats.jit_ticks);
+    phase("cache", stats.cache_ticks);
 }
 
-#endif  // defined(__aarch64__)
+#endif  // defined(__aarch64__) || defined(SKYLINE_STANDIN)
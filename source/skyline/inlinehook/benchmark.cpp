@@ -0,0 +1,159 @@
+#include "skyline/inlinehook/And64InlineHook.hpp"
+#include "skyline/utils/call_once.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/cache.h"
+#include "skyline/nx/arm/counter.h"
+#include "skyline/nx/kernel/jit.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace skyline::inlinehook {
+
+using BenchFunction = u64 (*)(u64);
+
+// every case gets a target of its own, as hooks stay installed between runs. the constants keep the linker from
+// folding them into one function
+#define BENCH_TARGET(name, k)                          \
+    __attribute__((noinline)) static u64 name(u64 x) { \
+        asm volatile("" : "+r"(x));                    \
+        return x * 3 + k;                              \
+    }
+
+BENCH_TARGET(benchDirect, 1)
+BENCH_TARGET(benchFar, 2)
+BENCH_TARGET(benchHooked, 3)
+BENCH_TARGET(benchOriginal, 4)
+BENCH_TARGET(benchInlineMinimal, 5)
+BENCH_TARGET(benchInlineAll, 6)
+BENCH_TARGET(benchCounted, 7)
+BENCH_TARGET(benchTimed, 8)
+
+static BenchFunction s_Original;
+
+__attribute__((noinline)) static u64 benchReplace(u64 x) {
+    asm volatile("" : "+r"(x));
+    return x * 3 + 9;
+}
+
+__attribute__((noinline)) static u64 benchReplaceCallOriginal(u64 x) { return s_Original(x); }
+
+static void benchCallback(InlineCtx*) {}
+
+struct BenchCase {
+    const char* name;
+    BenchFunction function;
+    bool installed;
+};
+
+enum {
+    BenchCase_Direct,
+    BenchCase_Far,
+    BenchCase_Hooked,
+    BenchCase_Original,
+    BenchCase_InlineMinimal,
+    BenchCase_InlineAll,
+    BenchCase_Counted,
+    BenchCase_Timed,
+    BenchCase_Count,
+};
+
+static BenchCase s_Cases[BenchCase_Count] = {
+    {"direct call", benchDirect, true},
+    {"far LDR/BR", nullptr, false},
+    {"hook, B to replacement", benchHooked, false},
+    {"hook, calls original", benchOriginal, false},
+    {"inline hook, caller-saved", benchInlineMinimal, false},
+    {"inline hook, all registers", benchInlineAll, false},
+    {"count hook", benchCounted, false},
+    {"time hook", benchTimed, false},
+};
+
+static utils::Once s_SetupOnce;
+static Jit s_FarJit;
+static u64 s_Counter;
+static HookTimeStats s_TimeStats;
+static u64 s_Sink;
+
+// the in-place far patch and pool veneers both branch through LDR X17/BR X17. hooks within skyline never need one,
+// so the sequence is measured from a JIT page of its own
+static BenchFunction makeFarStub(BenchFunction target) {
+    if (R_FAILED(jitCreate(&s_FarJit, NULL, 0x1000))) return nullptr;
+
+    auto rw = static_cast<uint32_t*>(s_FarJit.rw_addr);
+    rw[0] = 0x58000051u;  // LDR X17, #0x8
+    rw[1] = 0xd61f0220u;  // BR X17
+    *reinterpret_cast<BenchFunction*>(rw + 2) = target;
+
+    armDCacheFlush(s_FarJit.rw_addr, 4 * sizeof(uint32_t));
+    if (R_FAILED(jitTransitionToExecutable(&s_FarJit))) return nullptr;
+    armICacheInvalidate(s_FarJit.rx_addr, 4 * sizeof(uint32_t));
+    return reinterpret_cast<BenchFunction>(s_FarJit.rx_addr);
+}
+
+static void setup() {
+    BenchCase& far = s_Cases[BenchCase_Far];
+    far.function = makeFarStub(benchFar);
+    far.installed = far.function != nullptr;
+
+    s_Cases[BenchCase_Hooked].installed =
+        A64HookFunction(reinterpret_cast<void*>(benchHooked), reinterpret_cast<void*>(benchReplace), NULL) != 0;
+    s_Cases[BenchCase_Original].installed =
+        A64HookFunction(reinterpret_cast<void*>(benchOriginal), reinterpret_cast<void*>(benchReplaceCallOriginal),
+                        reinterpret_cast<void**>(&s_Original)) != 0;
+    s_Cases[BenchCase_InlineMinimal].installed =
+        A64InlineHookEx(reinterpret_cast<void*>(benchInlineMinimal), reinterpret_cast<void*>(benchCallback),
+                        A64_INLINE_REGS_CALLER_SAVED) != 0;
+    s_Cases[BenchCase_InlineAll].installed =
+        A64InlineHook(reinterpret_cast<void*>(benchInlineAll), reinterpret_cast<void*>(benchCallback)) != 0;
+    s_Cases[BenchCase_Counted].installed =
+        R_SUCCEEDED(A64CountHook(reinterpret_cast<void*>(benchCounted), &s_Counter));
+    s_Cases[BenchCase_Timed].installed = R_SUCCEEDED(A64TimeHook(reinterpret_cast<void*>(benchTimed), &s_TimeStats));
+}
+
+// kept out of line, so every iteration goes through an actual indirect call
+__attribute__((noinline)) static u64 timeCalls(BenchFunction function, u32 iterations) {
+    u64 x = 0;
+    u64 start = armGetSystemTick();
+    for (u32 i = 0; i < iterations; i++) x = function(x);
+    u64 ticks = armGetSystemTick() - start;
+
+    __atomic_store_n(&s_Sink, x, __ATOMIC_RELAXED);
+    return ticks;
+}
+
+};  // namespace skyline::inlinehook
+
+extern "C" Result A64HookBenchmark(u32 iterations) {
+    using namespace skyline::inlinehook;
+    R_UNLESS(iterations != 0, MAKERESULT(Module_Skyline, SkylineError_InvalidBenchmarkIterations));
+
+    s_SetupOnce.call_once(setup);
+
+    // warm the caches and branch predictors up before anything is measured
+    for (auto& bench : s_Cases) {
+        if (bench.installed) timeCalls(bench.function, iterations / 16 + 1);
+    }
+
+    double directNs = 0;
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] call overhead over %u calls:", iterations);
+    skyline::logger::s_Instance->LogFormat("  %-28s %10s %10s", "mechanism", "ns/call", "vs direct");
+    for (size_t i = 0; i < BenchCase_Count; i++) {
+        const BenchCase& bench = s_Cases[i];
+        if (!bench.installed) {
+            skyline::logger::s_Instance->LogFormat("  %-28s %10s", bench.name, "n/a");
+            continue;
+        }  // if
+
+        double ns = static_cast<double>(armTicksToNs(timeCalls(bench.function, iterations))) / iterations;
+        if (i == BenchCase_Direct) directNs = ns;
+        skyline::logger::s_Instance->LogFormat("  %-28s %10.2f %+10.2f", bench.name, ns, ns - directNs);
+    }
+
+    return 0;
+}
@@ -1,6 +1,10 @@
 #include "skyline/inlinehook/controlledpages.hpp"
 
+#include <map>
+
 #include "nn/os.hpp"
+#include "skyline/inlinehook/installstats.hpp"
+#include "skyline/utils/call_once.hpp"
 #include "skyline/utils/cpputils.hpp"
 
 #ifdef __cplusplus
@@ -108,17 +112,193 @@ static Result locateMappableSpace(uintptr_t* out_address, size_t size) {
     return locateMappableSpaceModern(out_address, size);
 }
 
+static bool overlapsRegion(uintptr_t start, uintptr_t end, uintptr_t region_base, size_t region_size) {
+    return region_size && region_base < end && start < region_base + region_size;
+}
+
+Result locateMappableSpaceNear(uintptr_t* out_address, size_t size, uintptr_t near, size_t range) {
+    AddressSpaceInfo address_space;
+    R_TRY(getProcessAddressSpaceInfo(&address_space, CUR_PROCESS_HANDLE));
+
+    uintptr_t lo = MAX(near > range ? near - range : 0, address_space.aslr_base);
+    uintptr_t hi = MIN(near + range, address_space.aslr_end);
+
+    uintptr_t best = 0;
+    uintptr_t best_distance = UINTPTR_MAX;
+
+    // walk the memory map block by block, keeping the free spot closest to near
+    MemoryInfo mem_info = {};
+    u32 page_info = 0;
+    for (uintptr_t cur = lo; cur < hi; cur = mem_info.addr + mem_info.size) {
+        R_TRY(svcQueryMemory(&mem_info, &page_info, cur));
+        if (mem_info.addr + mem_info.size <= cur) break;  // end of the address space
+        if (mem_info.type != MemType_Unmapped) continue;
+
+        uintptr_t start = MAX(mem_info.addr, lo);
+        uintptr_t end = MIN(mem_info.addr + mem_info.size, hi);
+
+        // hug the side of the block facing near
+        uintptr_t candidate = end <= near ? ALIGN_DOWN(end - size, PAGE_SIZE) : ALIGN_UP(start, PAGE_SIZE);
+        if (end - start < size || candidate < start || candidate + size > end) continue;
+        if (overlapsRegion(candidate, candidate + size, address_space.heap_base, address_space.heap_size) ||
+            overlapsRegion(candidate, candidate + size, address_space.alias_base, address_space.alias_size))
+            continue;
+
+        uintptr_t distance = candidate < near ? near - candidate : candidate + size - near;
+        if (distance < best_distance) {
+            best = candidate;
+            best_distance = distance;
+        }
+    }
+
+    R_UNLESS(best != 0, KERNELRESULT(OutOfMemory));
+    *out_address = best;
+    return 0;
+}
+
+Result mapPersistentAlias(uintptr_t rx, size_t size, uintptr_t* out_rw) {
+    InstallTimer timer(InstallPhase_Claim);
+
+    u64 dst;
+    R_TRY(locateMappableSpace(&dst, size));
+    R_TRY(svcMapProcessMemory((void*)dst, envGetOwnProcessHandle(), rx, size));
+    *out_rw = dst;
+    return 0;
+}
+
+// aliases are mapped in windows of this size, so neighbouring patches share a single mapping
+static constexpr size_t ALIAS_WINDOW_SIZE = 0x100000;
+
+struct PageAlias {
+    u64 rw;
+    size_t size;
+    u32 refCount;
+};
+
+// keyed by the first page of .text each alias mirrors, aliases never overlap
+static std::map<u64, PageAlias> s_PageAliases;
+static nn::os::MutexType s_PageAliasMutex;
+static skyline::utils::Once s_PageAliasInit;
+
+static void lockPageAliases() {
+    s_PageAliasInit.call_once([]() { nn::os::InitializeMutex(&s_PageAliasMutex, false, 0); });
+    nn::os::LockMutex(&s_PageAliasMutex);
+}
+
+static Result unmapPageAlias(u64 rx, PageAlias const& alias) {
+    return svcUnmapProcessMemory((void*)alias.rw, envGetOwnProcessHandle(), rx, alias.size);
+}
+
+bool PageAliasCache::acquire(u64 rx, size_t size, u64* out_rw) {
+    // only the main module's .text is guaranteed to stay mapped for the lifetime of the process
+    u64 textStart = skyline::utils::g_MainTextAddr;
+    u64 textEnd = skyline::utils::g_MainRodataAddr;
+    if (rx < textStart || rx + size > textEnd) return false;
+
+    lockPageAliases();
+
+    // find the alias starting at or before rx
+    auto it = s_PageAliases.upper_bound(rx);
+    if (it != s_PageAliases.begin()) {
+        auto& [aliasRx, alias] = *std::prev(it);
+        if (rx + size <= aliasRx + alias.size) {
+            alias.refCount++;
+            *out_rw = alias.rw + (rx - aliasRx);
+            nn::os::UnlockMutex(&s_PageAliasMutex);
+            return true;
+        }
+    }
+
+    u64 windowStart = textStart + ALIGN_DOWN(rx - textStart, ALIAS_WINDOW_SIZE);
+    u64 windowEnd = MIN(textStart + ALIGN_UP(rx + size - textStart, ALIAS_WINDOW_SIZE), textEnd);
+
+    // any alias in the way is folded into the new window, unless someone is still writing through it
+    auto first = s_PageAliases.upper_bound(windowStart);
+    if (first != s_PageAliases.begin() && std::prev(first)->first + std::prev(first)->second.size > windowStart)
+        first--;
+    auto last = s_PageAliases.lower_bound(windowEnd);
+    for (auto cur = first; cur != last; cur++) {
+        if (cur->second.refCount != 0) {
+            nn::os::UnlockMutex(&s_PageAliasMutex);
+            return false;
+        }
+    }
+    for (auto cur = first; cur != last; cur++) {
+        windowStart = MIN(windowStart, cur->first);
+        windowEnd = MAX(windowEnd, cur->first + cur->second.size);
+        R_ERRORONFAIL(unmapPageAlias(cur->first, cur->second));
+    }
+    s_PageAliases.erase(first, last);
+
+    u64 dst;
+    Result rc = locateMappableSpace(&dst, windowEnd - windowStart);
+    if (R_SUCCEEDED(rc))
+        rc = svcMapProcessMemory((void*)dst, envGetOwnProcessHandle(), windowStart, windowEnd - windowStart);
+    if (R_FAILED(rc)) {
+        nn::os::UnlockMutex(&s_PageAliasMutex);
+        return false;
+    }
+
+    s_PageAliases[windowStart] = PageAlias{.rw = dst, .size = windowEnd - windowStart, .refCount = 1};
+    *out_rw = dst + (rx - windowStart);
+
+    nn::os::UnlockMutex(&s_PageAliasMutex);
+    return true;
+}
+
+void PageAliasCache::release(u64 rx) {
+    lockPageAliases();
+
+    auto it = s_PageAliases.upper_bound(rx);
+    if (it != s_PageAliases.begin()) {
+        auto& alias = std::prev(it)->second;
+        if (alias.refCount != 0) alias.refCount--;
+    }
+
+    nn::os::UnlockMutex(&s_PageAliasMutex);
+}
+
+size_t PageAliasCache::trim() {
+    size_t trimmed = 0;
+
+    lockPageAliases();
+
+    auto it = s_PageAliases.begin();
+    while (it != s_PageAliases.end()) {
+        if (it->second.refCount == 0 && R_SUCCEEDED(unmapPageAlias(it->first, it->second))) {
+            trimmed += it->second.size;
+            it = s_PageAliases.erase(it);
+        } else
+            it++;
+    }
+
+    nn::os::UnlockMutex(&s_PageAliasMutex);
+    return trimmed;
+}
+
 ControlledPages::ControlledPages(void* rx, size_t size) {
     this->rx = rx;
     this->size = size;
     isClaimed = false;
+    isCached = false;
 }
 
 void ControlledPages::claim() {
     if (!isClaimed) {
+        InstallTimer timer(InstallPhase_Claim);
+
+        // try to reuse a persistent alias first
+        u64 cachedRw;
+        if (PageAliasCache::acquire((u64)rx, size, &cachedRw)) {
+            rw = (void*)cachedRw;
+            isClaimed = true;
+            isCached = true;
+            return;
+        }
+
         // get actual pages
         u64 alignedSrc = ALIGN_DOWN((u64)rx, PAGE_SIZE);
-        size_t alignedSize = ALIGN_UP(size, PAGE_SIZE);
+        size_t alignedSize = ALIGN_UP((u64)rx + size, PAGE_SIZE) - alignedSrc;
 
         // reserve space for rw pages
         u64 dst;
@@ -140,21 +320,34 @@ void ControlledPages::claim() {
 
 void ControlledPages::unclaim() {
     if (isClaimed) {
-        // get actual pages
-        u64 alignedSrc = ALIGN_DOWN((u64)rx, PAGE_SIZE);
-        void* alignedDst = (void*)ALIGN_DOWN((u64)rw, PAGE_SIZE);
-        size_t alignedSize = ALIGN_UP(size, PAGE_SIZE);
-
         // invalidate caches
-        armDCacheFlush((void*)alignedDst, size);
-        armICacheInvalidate((void*)alignedSrc, size);
+        {
+            InstallTimer timer(InstallPhase_Cache);
+            armDCacheFlush(rw, size);
+            armICacheInvalidate(rx, size);
+        }
+
+        InstallTimer timer(InstallPhase_Claim);
 
-        // unmap pages
-        R_ERRORONFAIL(svcUnmapProcessMemory(alignedDst, envGetOwnProcessHandle(), alignedSrc, alignedSize));
+        if (isCached) {
+            // the alias stays mapped until the cache is trimmed
+            PageAliasCache::release((u64)rx);
+        } else {
+            // get actual pages
+            u64 alignedSrc = ALIGN_DOWN((u64)rx, PAGE_SIZE);
+            void* alignedDst = (void*)ALIGN_DOWN((u64)rw, PAGE_SIZE);
+            size_t alignedSize = ALIGN_UP((u64)rx + size, PAGE_SIZE) - alignedSrc;
+
+            // unmap pages
+            R_ERRORONFAIL(svcUnmapProcessMemory(alignedDst, envGetOwnProcessHandle(), alignedSrc, alignedSize));
+        }
 
         // clean up variables
         rw = NULL;
         isClaimed = false;
+        isCached = false;
     }
 }
 };  // namespace skyline::inlinehook
+
+size_t sky_trim_page_aliases() { return skyline::inlinehook::PageAliasCache::trim(); }
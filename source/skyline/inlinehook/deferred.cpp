@@ -0,0 +1,149 @@
+#include "skyline/inlinehook/deferred.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nn/os.hpp"
+#include "nn/ro.h"
+#include "skyline/inlinehook/And64InlineHook.hpp"
+#include "skyline/utils/SymbolMap.hpp"
+#include "skyline/utils/call_once.hpp"
+
+namespace skyline::inlinehook {
+
+struct DeferredHook {
+    std::string name;
+    void* replace;
+    void** result;
+    HookHandle handle;
+    bool enabled;
+};
+
+static std::vector<DeferredHook> s_Pending;
+static nn::os::MutexType s_PendingMutex;
+static utils::Once s_PendingInit;
+
+static Result (*loadModuleImpl)(nn::ro::Module*, const void*, void*, size_t, int);
+static Result (*unloadModuleImpl)(nn::ro::Module*);
+
+// held while modules are indexed for symbolize or unloaded, so a module that is going away isn't indexed again
+static nn::os::MutexType s_ModulesMutex;
+static utils::Once s_ModulesInit;
+
+static void lockPending() {
+    s_PendingInit.call_once([]() { nn::os::InitializeMutex(&s_PendingMutex, false, 0); });
+    nn::os::LockMutex(&s_PendingMutex);
+}
+
+static uintptr_t lookup(const std::string& name) {
+    uintptr_t address = 0;
+    if (R_SUCCEEDED(nn::ro::LookupSymbol(&address, name.c_str())) && address != 0) return address;
+    return utils::SymbolMap::getSymbolAddress(name);
+}
+
+// the module is bound by the time LoadModule returns, its symbols can be looked up right away
+static Result handleLoadModule(nn::ro::Module* module, const void* image, void* buffer, size_t bufferSize, int flag) {
+    Result rc = loadModuleImpl(module, image, buffer, bufferSize, flag);
+    if (R_FAILED(rc)) return rc;
+
+    nn::os::LockMutex(&s_ModulesMutex);
+    utils::SymbolMap::indexModules();
+    nn::os::UnlockMutex(&s_ModulesMutex);
+
+    DeferredHooks::resolve();
+    return rc;
+}
+
+// the module's index goes first, its names point into the module
+static Result handleUnloadModule(nn::ro::Module* module) {
+    nn::os::LockMutex(&s_ModulesMutex);
+    if (module != nullptr && module->ModuleObject != nullptr)
+        utils::SymbolMap::dropModule(module->ModuleObject->module_base);
+    Result rc = unloadModuleImpl(module);
+    // still loaded, indexed again
+    if (R_FAILED(rc)) utils::SymbolMap::indexModules();
+    nn::os::UnlockMutex(&s_ModulesMutex);
+    return rc;
+}
+
+void DeferredHooks::trackModules() {
+    s_ModulesInit.call_once([]() { nn::os::InitializeMutex(&s_ModulesMutex, false, 0); });
+
+    // every NSO is mapped by now, later modules are indexed as they load
+    nn::os::LockMutex(&s_ModulesMutex);
+    utils::SymbolMap::indexModules();
+    nn::os::UnlockMutex(&s_ModulesMutex);
+
+    const HookSpec hooks[] = {
+        {reinterpret_cast<void*>(nn::ro::LoadModule), reinterpret_cast<void*>(handleLoadModule),
+         reinterpret_cast<void**>(&loadModuleImpl)},
+        {reinterpret_cast<void*>(nn::ro::UnloadModule), reinterpret_cast<void*>(handleUnloadModule),
+         reinterpret_cast<void**>(&unloadModuleImpl)},
+    };
+    A64HookFunctionBatch(hooks, sizeof(hooks) / sizeof(hooks[0]));
+}
+
+size_t DeferredHooks::resolve() {
+    lockPending();
+
+    std::vector<HookSpec> specs;
+    std::vector<HookHandle> handles;
+    std::vector<DeferredHook> waiting;
+    for (auto& hook : s_Pending) {
+        uintptr_t address = hook.enabled ? lookup(hook.name) : 0;
+        if (address != 0) {
+            specs.push_back({reinterpret_cast<void*>(address), hook.replace, hook.result, 0, NULL});
+            handles.push_back(hook.handle);
+        } else {
+            waiting.push_back(std::move(hook));
+        }
+    }
+    s_Pending = std::move(waiting);
+
+    // the hooks are installed before they leave the queue's lock, so a handle is always found in one or the other
+    if (!specs.empty()) A64HookFunctionBatchReserved(specs.data(), handles.data(), specs.size());
+
+    nn::os::UnlockMutex(&s_PendingMutex);
+    return specs.size();
+}
+
+static std::vector<DeferredHook>::iterator findPending(HookHandle handle) {
+    return std::find_if(s_Pending.begin(), s_Pending.end(),
+                        [handle](const DeferredHook& hook) { return hook.handle == handle; });
+}
+
+bool DeferredHooks::setEnabled(HookHandle handle, bool enabled) {
+    lockPending();
+    auto it = findPending(handle);
+    bool found = it != s_Pending.end();
+    if (found) it->enabled = enabled;
+    nn::os::UnlockMutex(&s_PendingMutex);
+
+    if (found && enabled) resolve();
+    return found;
+}
+
+bool DeferredHooks::cancel(HookHandle handle) {
+    lockPending();
+    auto it = findPending(handle);
+    bool found = it != s_Pending.end();
+    if (found) s_Pending.erase(it);
+    nn::os::UnlockMutex(&s_PendingMutex);
+    return found;
+}
+
+};  // namespace skyline::inlinehook
+
+extern "C" HookHandle A64HookFunctionDeferred(const char* symbol_name, void* const replace, void** result) {
+    using namespace skyline::inlinehook;
+
+    HookHandle handle = A64HookReserveHandle();
+
+    lockPending();
+    s_Pending.push_back({symbol_name, replace, result, handle, true});
+    nn::os::UnlockMutex(&s_PendingMutex);
+    return handle;
+}
+
+extern "C" size_t A64HookResolveDeferred() { return skyline::inlinehook::DeferredHooks::resolve(); }
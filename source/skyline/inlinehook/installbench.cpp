@@ -0,0 +1,138 @@
+#include <vector>
+
+#include "skyline/inlinehook/And64InlineHook.hpp"
+#include "skyline/logger/Logger.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/cache.h"
+#include "skyline/nx/arm/counter.h"
+#include "skyline/nx/kernel/jit.h"
+#include "skyline/utils/utils.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace skyline::inlinehook {
+
+// every synthetic function starts on an ADRP, so each install relocates a PC-relative instruction like most real
+// prologues make it, and calls a shared leaf the way a non-leaf function would
+static constexpr size_t FUNCTION_INSTRUCTIONS = 8;
+static constexpr size_t FUNCTION_SIZE = FUNCTION_INSTRUCTIONS * sizeof(uint32_t);
+
+static constexpr uint32_t NOP = 0xd503201fu;
+static constexpr uint32_t RET = 0xd65f03c0u;
+
+static uint32_t adrp(uintptr_t pc, uintptr_t to, uint32_t rd) {
+    int64_t imm = static_cast<int64_t>(to >> 12) - static_cast<int64_t>(pc >> 12);
+    return 0x90000000u | ((imm & 3) << 29) | (((imm >> 2) & 0x7ffff) << 5) | rd;
+}
+
+static uint32_t bl(uintptr_t pc, uintptr_t to) {
+    return 0x94000000u | ((static_cast<int64_t>(to - pc) >> 2) & 0x3ffffff);
+}
+
+// fills the pool with a leaf at its start and count functions after it, given where it will be executable
+static void emitFunctions(uint32_t* rw, uintptr_t rx, size_t count) {
+    rw[0] = 0xd2800000u;  // MOV X0, #0
+    rw[1] = RET;
+    for (size_t i = 2; i < FUNCTION_INSTRUCTIONS; i++) rw[i] = NOP;
+
+    for (size_t i = 1; i <= count; i++) {
+        uint32_t* code = rw + i * FUNCTION_INSTRUCTIONS;
+        uintptr_t pc = rx + i * FUNCTION_SIZE;
+        code[0] = adrp(pc, rx, 8);
+        code[1] = 0xa9bf7bfdu;  // STP X29, X30, [SP, #-16]!
+        code[2] = 0x910003fdu;  // MOV X29, SP
+        code[3] = 0xb4000060u;  // CBZ X0, #12
+        code[4] = bl(pc + 4 * sizeof(uint32_t), rx);
+        code[5] = NOP;
+        code[6] = 0xa8c17bfdu;  // LDP X29, X30, [SP], #16
+        code[7] = RET;
+    }
+}
+
+static void logPass(const char* name, size_t count, const HookInstallStats& before, const HookInstallStats& after,
+                    u64 installTicks, u64 removeTicks) {
+    auto perHook = [&](u64 from, u64 to) { return armTicksToNs(to - from) / count; };
+    skyline::logger::s_Instance->LogFormat(
+        "  %-10s %8lu %8lu %8lu %8lu %8lu %8lu %8lu", name, armTicksToNs(installTicks) / count,
+        perHook(before.total_ticks, after.total_ticks), perHook(before.claim_ticks, after.claim_ticks),
+        perHook(before.relocate_ticks, after.relocate_ticks), perHook(before.jit_ticks, after.jit_ticks),
+        perHook(before.cache_ticks, after.cache_ticks), armTicksToNs(removeTicks) / count);
+}
+
+// removes every hook a pass installed, returning how many of them failed to install or to go
+static size_t removeHooks(const std::vector<HookHandle>& handles) {
+    size_t failures = 0;
+    for (HookHandle handle : handles) {
+        if (handle == 0 || R_FAILED(A64HookRemove(handle))) failures++;
+    }
+    return failures;
+}
+
+};  // namespace skyline::inlinehook
+
+extern "C" Result A64HookInstallBenchmark(u32 count) {
+    using namespace skyline::inlinehook;
+    R_UNLESS(count != 0, MAKERESULT(Module_Skyline, SkylineError_InvalidBenchmarkIterations));
+
+    Jit pool;
+    R_TRY(jitCreate(&pool, NULL, ALIGN_UP((count + 1) * FUNCTION_SIZE, 0x1000)));
+    uintptr_t rx = reinterpret_cast<uintptr_t>(pool.rx_addr);
+    emitFunctions(static_cast<uint32_t*>(pool.rw_addr), rx, count);
+    armDCacheFlush(pool.rw_addr, pool.size);
+    Result rc = jitTransitionToExecutable(&pool);
+    if (R_FAILED(rc)) {
+        jitClose(&pool);
+        return rc;
+    }
+    armICacheInvalidate(pool.rx_addr, pool.size);
+
+    auto function = [&](size_t i) { return reinterpret_cast<void*>(rx + (i + 1) * FUNCTION_SIZE); };
+    void* replace = pool.rx_addr;
+
+    skyline::logger::s_Instance->LogFormat("[And64InlineHook] installing %u hooks, ns per hook:", count);
+    skyline::logger::s_Instance->LogFormat("  %-10s %8s %8s %8s %8s %8s %8s %8s", "pass", "wall", "total", "claim",
+                                           "relocate", "jit", "cache", "remove");
+
+    // every function is hooked and unhooked again in each pass, so both start from the same pool
+    size_t failures = 0;
+    std::vector<HookHandle> handles(count);
+    HookInstallStats before, after;
+
+    A64HookGetInstallStats(&before);
+    u64 start = armGetSystemTick();
+    for (size_t i = 0; i < count; i++) handles[i] = A64HookFunction(function(i), replace, NULL);
+    u64 installTicks = armGetSystemTick() - start;
+    A64HookGetInstallStats(&after);
+
+    start = armGetSystemTick();
+    failures += removeHooks(handles);
+    logPass("one by one", count, before, after, installTicks, armGetSystemTick() - start);
+
+    std::vector<HookSpec> specs(count);
+    for (size_t i = 0; i < count; i++) {
+        handles[i] = 0;
+        specs[i] = {function(i), replace, NULL, 0, &handles[i]};
+    }
+
+    A64HookGetInstallStats(&before);
+    start = armGetSystemTick();
+    A64HookFunctionBatch(specs.data(), count);
+    installTicks = armGetSystemTick() - start;
+    A64HookGetInstallStats(&after);
+
+    start = armGetSystemTick();
+    failures += removeHooks(handles);
+    logPass("batch", count, before, after, installTicks, armGetSystemTick() - start);
+
+    if (failures != 0) skyline::logger::s_Instance->LogFormat("  %zu hooks failed to install or remove", failures);
+
+    // every hook is gone and its trampoline back in the TrampolinePool, nothing runs through the functions anymore
+    jitClose(&pool);
+    return 0;
+}
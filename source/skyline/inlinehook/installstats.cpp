@@ -0,0 +1,23 @@
+#include "skyline/inlinehook/installstats.hpp"
+
+namespace skyline::inlinehook {
+
+static u64 s_PhaseTicks[InstallPhase_Count];
+static u64 s_Hooks;
+
+void InstallStats::add(InstallPhase phase, u64 ticks) {
+    __atomic_fetch_add(&s_PhaseTicks[phase], ticks, __ATOMIC_RELAXED);
+}
+
+void InstallStats::addHooks(u64 count) { __atomic_fetch_add(&s_Hooks, count, __ATOMIC_RELAXED); }
+
+u64 InstallStats::ticks(InstallPhase phase) { return __atomic_load_n(&s_PhaseTicks[phase], __ATOMIC_RELAXED); }
+
+u64 InstallStats::hooks() { return __atomic_load_n(&s_Hooks, __ATOMIC_RELAXED); }
+
+void InstallStats::reset() {
+    for (auto& ticks : s_PhaseTicks) __atomic_store_n(&ticks, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_Hooks, 0, __ATOMIC_RELAXED);
+}
+
+};  // namespace skyline::inlinehook
@@ -0,0 +1,119 @@
+#include "skyline/inlinehook/probes.hpp"
+
+#include <cstdlib>
+
+#include "nn/os.hpp"
+#include "skyline/inlinehook/And64InlineHook.hpp"
+#include "skyline/inlinehook/tracing.hpp"
+#include "skyline/utils/call_once.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/counter.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace skyline::inlinehook {
+
+// deeper recursion is still called through, but isn't timed
+#define SHADOW_STACK_DEPTH 64
+
+struct ShadowFrame {
+    uintptr_t lr;
+    uintptr_t stats;  // tagged pointer or trace id, or 0 for a frame that is only subtracted from its parent
+    u64 start;
+    u64 nested;  // ticks spent in timed frames called from this one
+};
+
+struct ShadowStack {
+    size_t depth;
+    ShadowFrame frames[SHADOW_STACK_DEPTH];
+};
+
+static nn::os::TlsSlot s_ShadowStackSlot;
+static utils::Once s_InitOnce;
+static Result s_InitResult;
+
+// marks a thread whose shadow stack is being allocated, so probes on the allocator don't recurse
+static constexpr uintptr_t SHADOW_STACK_PENDING = 1;
+
+// every thread that ran a probe owns a shadow stack, which goes with the thread
+static void destroyShadowStack(uintptr_t value) {
+    if (value != 0 && value != SHADOW_STACK_PENDING) free(reinterpret_cast<void*>(value));
+}
+
+static void trace(u64 tick, u32 id) {
+    TraceRing* ring = TraceRings::current();
+    if (ring != NULL) TraceRings::push(ring, tick, id);
+}
+
+Result TimeProbes::initialize() {
+    s_InitOnce.call_once(
+        []() { s_InitResult = nn::os::AllocateTlsSlot(&s_ShadowStackSlot, destroyShadowStack); });
+    return s_InitResult;
+}
+
+static void recordTicks(HookTimeStats* stats, u64 ticks) {
+    __atomic_fetch_add(&stats->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->total_ticks, ticks, __ATOMIC_RELAXED);
+
+    u64 current = __atomic_load_n(&stats->min_ticks, __ATOMIC_RELAXED);
+    while (ticks < current) {
+        if (__atomic_compare_exchange_n(&stats->min_ticks, &current, ticks, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+    current = __atomic_load_n(&stats->max_ticks, __ATOMIC_RELAXED);
+    while (ticks > current) {
+        if (__atomic_compare_exchange_n(&stats->max_ticks, &current, ticks, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+}
+
+};  // namespace skyline::inlinehook
+
+using namespace skyline::inlinehook;
+
+extern "C" uintptr_t skyline_time_probe_enter(const void* block, uintptr_t lr) {
+    auto stack = reinterpret_cast<ShadowStack*>(nn::os::GetTlsValue(s_ShadowStackSlot));
+    if (stack == NULL) {
+        nn::os::SetTlsValue(s_ShadowStackSlot, SHADOW_STACK_PENDING);
+        stack = static_cast<ShadowStack*>(calloc(1, sizeof(ShadowStack)));
+        nn::os::SetTlsValue(s_ShadowStackSlot, reinterpret_cast<uintptr_t>(stack));
+    }  // if
+
+    // returning lr leaves the call untimed, the function then returns straight to its caller
+    if (stack == NULL || reinterpret_cast<uintptr_t>(stack) == SHADOW_STACK_PENDING ||
+        stack->depth == SHADOW_STACK_DEPTH)
+        return lr;
+
+    // the probe block starts with the exit probe, followed by the stats pointer
+    ShadowFrame& frame = stack->frames[stack->depth++];
+    frame.lr = lr;
+    frame.stats = *reinterpret_cast<const uintptr_t*>(reinterpret_cast<uintptr_t>(block) + 8);
+    frame.nested = 0;
+    frame.start = armGetSystemTick();
+    if (frame.stats & TIME_PROBE_TRACE) trace(frame.start, frame.stats >> TIME_PROBE_TRACE_SHIFT);
+    return reinterpret_cast<uintptr_t>(block);
+}
+
+extern "C" uintptr_t skyline_time_probe_exit() {
+    u64 end = armGetSystemTick();
+
+    // only reached through a frame pushed by skyline_time_probe_enter
+    auto stack = reinterpret_cast<ShadowStack*>(nn::os::GetTlsValue(s_ShadowStackSlot));
+    ShadowFrame& frame = stack->frames[--stack->depth];
+    u64 ticks = end - frame.start;
+    if (stack->depth != 0) stack->frames[stack->depth - 1].nested += ticks;
+
+    if (frame.stats & TIME_PROBE_TRACE) {
+        trace(end, (frame.stats >> TIME_PROBE_TRACE_SHIFT) | TRACE_RECORD_EXIT);
+    } else if (frame.stats != 0) {
+        auto stats = reinterpret_cast<HookTimeStats*>(frame.stats & ~TIME_PROBE_EXCLUSIVE);
+        recordTicks(stats, (frame.stats & TIME_PROBE_EXCLUSIVE) ? ticks - frame.nested : ticks);
+    }  // if
+    return frame.lr;
+}
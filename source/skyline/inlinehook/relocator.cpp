@@ -0,0 +1,512 @@
+/*
+ *  @date   : 2018/04/18
+ *  @author : Rprop (r_prop@outlook.com)
+ *  https://github.com/Rprop/And64InlineHook
+ */
+/*
+ MIT License
+
+ Copyright (c) 2018 Rprop (r_prop@outlook.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "skyline/inlinehook/relocator.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace skyline::inlinehook {
+
+typedef uint32_t* __restrict* __restrict instruction;
+typedef struct {
+    struct fix_info {
+        uint32_t* bprx;
+        uint32_t* bprw;
+        uint32_t ls;  // left-shift counts
+        uint32_t ad;  // & operand
+    };
+    struct insns_info {
+        union {
+            uint64_t insu;
+            int64_t ins;
+            void* insp;
+        };
+        fix_info fmap[A64_MAX_REFERENCES];
+    };
+    int64_t basep;
+    int64_t endp;
+    insns_info dat[A64_MAX_INSTRUCTIONS];
+
+   public:
+    inline bool is_in_fixing_range(const int64_t absolute_addr) {
+        return absolute_addr >= this->basep && absolute_addr < this->endp;
+    }
+    inline intptr_t get_ref_ins_index(const int64_t absolute_addr) {
+        return static_cast<intptr_t>((absolute_addr - this->basep) / sizeof(uint32_t));
+    }
+    inline intptr_t get_and_set_current_index(uint32_t* __restrict inp, uint32_t* __restrict outp) {
+        intptr_t current_idx = this->get_ref_ins_index(reinterpret_cast<int64_t>(inp));
+        this->dat[current_idx].insp = outp;
+        return current_idx;
+    }
+    inline void reset_current_ins(const intptr_t idx, uint32_t* __restrict outp) { this->dat[idx].insp = outp; }
+    void insert_fix_map(const intptr_t idx, uint32_t* bprw, uint32_t* bprx, uint32_t ls = 0u,
+                        uint32_t ad = 0xffffffffu) {
+        for (auto& f : this->dat[idx].fmap) {
+            if (f.bprw == NULL) {
+                f.bprw = bprw;
+                f.bprx = bprx;
+                f.ls = ls;
+                f.ad = ad;
+                return;
+            }  // if
+        }
+        // What? GGing..
+    }
+    void process_fix_map(const intptr_t idx) {
+        for (auto& f : this->dat[idx].fmap) {
+            if (f.bprw == NULL) break;
+            // the placeholder is read back through rw, rx may not be mapped (or written) yet
+            *(f.bprw) =
+                *(f.bprw) | (((int32_t(this->dat[idx].ins - reinterpret_cast<int64_t>(f.bprx)) >> 2) << f.ls) & f.ad);
+            f.bprw = NULL;
+            f.bprx = NULL;
+        }
+    }
+} context;
+
+//-------------------------------------------------------------------------
+
+static bool __fix_branch_imm(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
+                             context* ctxp) {
+    static constexpr uint32_t mbits = 6u;
+    static constexpr uint32_t mask = 0xfc000000u;   // 0b11111100000000000000000000000000
+    static constexpr uint32_t rmask = 0x03ffffffu;  // 0b00000011111111111111111111111111
+    static constexpr uint32_t op_b = 0x14000000u;   // "b"  ADDR_PCREL26
+    static constexpr uint32_t op_bl = 0x94000000u;  // "bl" ADDR_PCREL26
+
+    const uint32_t ins = *(*inprwp);
+    const uint32_t opc = ins & mask;
+    switch (opc) {
+        case op_b:
+        case op_bl: {
+            intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
+            int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) +
+                                    (static_cast<int32_t>(ins << mbits) >> (mbits - 2u));  // sign-extended
+            int64_t new_pc_offset =
+                static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
+            bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
+            // whether the branch should be converted to absolute jump
+            if (!special_fix_type && llabs(new_pc_offset) >= (rmask >> 1)) {
+                bool b_aligned = (reinterpret_cast<uint64_t>(*outprx + 2) & 7u) == 0u;
+                if (opc == op_b) {
+                    if (b_aligned != true) {
+                        (*outprw)[0] = A64_NOP;
+                        ctxp->reset_current_ins(current_idx, ++(*outprx));
+                        ++(*outprw);
+                    }                            // if
+                    (*outprw)[0] = 0x58000051u;  // LDR X17, #0x8
+                    (*outprw)[1] = 0xd61f0220u;  // BR X17
+                    memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));
+                    *outprx += 4;
+                    *outprw += 4;
+                } else {
+                    if (b_aligned == true) {
+                        (*outprw)[0] = A64_NOP;
+                        ctxp->reset_current_ins(current_idx, ++(*outprx));
+                        (*outprw)++;
+                    }                            // if
+                    (*outprw)[0] = 0x58000071u;  // LDR X17, #12
+                    (*outprw)[1] = 0x1000009eu;  // ADR X30, #16
+                    (*outprw)[2] = 0xd61f0220u;  // BR X17
+                    memcpy(*outprw + 3, &absolute_addr, sizeof(absolute_addr));
+                    *outprw += 5;
+                    *outprx += 5;
+                }  // if
+            } else {
+                if (special_fix_type) {
+                    intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr);
+                    if (ref_idx <= current_idx) {
+                        new_pc_offset =
+                            static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx)) >> 2;
+                    } else {
+                        ctxp->insert_fix_map(ref_idx, *outprw, *outprx, 0u, rmask);
+                        new_pc_offset = 0;
+                    }  // if
+                }      // if
+
+                (*outprw)[0] = opc | (new_pc_offset & ~mask);
+                ++(*outprw);
+                ++(*outprx);
+            }  // if
+
+            ++(*inprxp);
+            ++(*inprwp);
+            return ctxp->process_fix_map(current_idx), true;
+        }
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------
+
+static bool __fix_cond_comp_test_branch(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
+                                        context* ctxp) {
+    static constexpr uint32_t lsb = 5u;
+    static constexpr uint32_t lmask01 = 0xff00001fu;  // 0b11111111000000000000000000011111
+    static constexpr uint32_t mask0 = 0xff000010u;    // 0b11111111000000000000000000010000
+    static constexpr uint32_t op_bc = 0x54000000u;    // "b.c"  ADDR_PCREL19
+    static constexpr uint32_t mask1 = 0x7f000000u;    // 0b01111111000000000000000000000000
+    static constexpr uint32_t op_cbz = 0x34000000u;   // "cbz"  Rt, ADDR_PCREL19
+    static constexpr uint32_t op_cbnz = 0x35000000u;  // "cbnz" Rt, ADDR_PCREL19
+    static constexpr uint32_t lmask2 = 0xfff8001fu;   // 0b11111111111110000000000000011111
+    static constexpr uint32_t mask2 = 0x7f000000u;    // 0b01111111000000000000000000000000
+    static constexpr uint32_t op_tbz =
+        0x36000000u;  // 0b00110110000000000000000000000000 "tbz"  Rt, BIT_NUM, ADDR_PCREL14
+    static constexpr uint32_t op_tbnz =
+        0x37000000u;  // 0b00110111000000000000000000000000 "tbnz" Rt, BIT_NUM, ADDR_PCREL14
+
+    const uint32_t ins = *(*inprwp);
+    uint32_t lmask = lmask01;
+    if ((ins & mask0) != op_bc) {
+        uint32_t opc = ins & mask1;
+        if (opc != op_cbz && opc != op_cbnz) {
+            opc = ins & mask2;
+            if (opc != op_tbz && opc != op_tbnz) {
+                return false;
+            }  // if
+            lmask = lmask2;
+        }  // if
+    }      // if
+
+    // imm19 at bit 5, or imm14 for TBZ/TBNZ, sign extended and scaled by 4
+    intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
+    int64_t imm = lmask == lmask2 ? static_cast<int32_t>(ins << 13u) >> 16u : static_cast<int32_t>(ins << 8u) >> 11u;
+    int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) + (imm & ~3ll);
+    int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
+    bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
+    if (!special_fix_type && llabs(new_pc_offset) >= (~lmask >> (lsb + 1))) {
+        if ((reinterpret_cast<uint64_t>(*outprx + 4) & 7u) != 0u) {
+            (*outprw)[0] = A64_NOP;
+            ctxp->reset_current_ins(current_idx, *outprx);
+
+            (*outprx)++;
+            (*outprw)++;
+        }                                                               // if
+        (*outprw)[0] = (((8u >> 2u) << lsb) & ~lmask) | (ins & lmask);  // B.C #0x8
+        (*outprw)[1] = 0x14000005u;                                     // B #0x14
+        (*outprw)[2] = 0x58000051u;                                     // LDR X17, #0x8
+        (*outprw)[3] = 0xd61f0220u;                                     // BR X17
+        memcpy(*outprw + 4, &absolute_addr, sizeof(absolute_addr));
+        *outprw += 6;
+        *outprx += 6;
+    } else {
+        if (special_fix_type) {
+            intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr);
+            if (ref_idx <= current_idx) {
+                new_pc_offset = static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx)) >> 2;
+            } else {
+                ctxp->insert_fix_map(ref_idx, *outprw, *outprx, lsb, ~lmask);
+                new_pc_offset = 0;
+            }  // if
+        }      // if
+
+        (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << lsb) & ~lmask) | (ins & lmask);
+        ++(*outprw);
+        ++(*outprx);
+    }  // if
+
+    ++(*inprxp);
+    ++(*inprwp);
+    return ctxp->process_fix_map(current_idx), true;
+}
+
+//-------------------------------------------------------------------------
+
+static bool __fix_loadlit(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
+                          context* ctxp) {
+    const uint32_t ins = *(*inprwp);
+
+    // memory prefetch("prfm"), just skip it
+    // http://infocenter.arm.com/help/topic/com.arm.doc.100069_0608_00_en/pge1427897420050.html
+    if ((ins & 0xff000000u) == 0xd8000000u) {
+        ctxp->process_fix_map(ctxp->get_and_set_current_index(*inprxp, *outprx));
+        ++(*inprwp);
+        ++(*inprxp);
+        return true;
+    }  // if
+
+    static constexpr uint32_t msb = 8u;
+    static constexpr uint32_t lsb = 5u;
+    static constexpr uint32_t mask_30 = 0x40000000u;   // 0b01000000000000000000000000000000
+    static constexpr uint32_t mask_31 = 0x80000000u;   // 0b10000000000000000000000000000000
+    static constexpr uint32_t lmask = 0xff00001fu;     // 0b11111111000000000000000000011111
+    static constexpr uint32_t mask_ldr = 0xbf000000u;  // 0b10111111000000000000000000000000
+    static constexpr uint32_t op_ldr =
+        0x18000000u;  // 0b00011000000000000000000000000000 "LDR Wt/Xt, label" | ADDR_PCREL19
+    static constexpr uint32_t mask_ldrv = 0x3f000000u;  // 0b00111111000000000000000000000000
+    static constexpr uint32_t op_ldrv =
+        0x1c000000u;  // 0b00011100000000000000000000000000 "LDR St/Dt/Qt, label" | ADDR_PCREL19
+    static constexpr uint32_t mask_ldrsw = 0xff000000u;  // 0b11111111000000000000000000000000
+    static constexpr uint32_t op_ldrsw = 0x98000000u;  // "LDRSW Xt, label" | ADDR_PCREL19 | load register signed word
+    // LDR S0, #0 | 0b00011100000000000000000000000000 | 32-bit
+    // LDR D0, #0 | 0b01011100000000000000000000000000 | 64-bit
+    // LDR Q0, #0 | 0b10011100000000000000000000000000 | 128-bit
+    // INVALID    | 0b11011100000000000000000000000000 | may be 256-bit
+
+    uintptr_t faligned = (ins & mask_30) ? 7u : 3u;
+    if ((ins & mask_ldr) != op_ldr) {
+        if (faligned != 7u) faligned = (ins & mask_31) ? 15u : 3u;
+        if ((ins & mask_ldrv) != op_ldrv) {
+            if ((ins & mask_ldrsw) != op_ldrsw) {
+                return false;
+            }  // if
+            faligned = 7u;
+        }  // if
+    }      // if
+
+    intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
+    int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) +
+                            (static_cast<int64_t>(static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3ll);
+    int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
+    bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
+    // special_fix_type may encounter issue when there are mixed data and code
+    if (special_fix_type ||
+        (llabs(new_pc_offset) + (faligned + 1u - 4u) / 4u) >= (~lmask >> (lsb + 1))) {  // inaccurate, but it works
+        while ((reinterpret_cast<uint64_t>(*outprx + 2) & faligned) != 0u) {
+            *(*outprw)++ = A64_NOP;
+            (*outprx)++;
+        }
+        ctxp->reset_current_ins(current_idx, *outprx);
+
+        // Note that if memory at absolute_addr is writeable (non-const), we will fail to fetch it.
+        // And what's worse, we may unexpectedly overwrite something if special_fix_type is true...
+        uint32_t ns = static_cast<uint32_t>((faligned + 1) / sizeof(uint32_t));
+        (*outprw)[0] = (((8u >> 2u) << lsb) & ~lmask) | (ins & lmask);  // LDR #0x8
+        (*outprw)[1] = 0x14000001u + ns;                                // B #0xc
+        memcpy(*outprw + 2, reinterpret_cast<void*>(absolute_addr), faligned + 1);
+        *outprw += 2 + ns;
+        *outprx += 2 + ns;
+    } else {
+        faligned >>= 2;  // new_pc_offset is shifted and 4-byte aligned
+        while ((new_pc_offset & faligned) != 0) {
+            *(*outprw)++ = A64_NOP;
+            (*outprx)++;
+            new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;
+        }
+        ctxp->reset_current_ins(current_idx, *outprx);
+
+        // only imm19 is replaced, a negative offset must not spill into opc
+        (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << lsb) & ~lmask) | (ins & lmask);
+        ++(*outprx);
+        ++(*outprw);
+    }  // if
+
+    ++(*inprxp);
+    ++(*inprwp);
+    return ctxp->process_fix_map(current_idx), true;
+}
+
+//-------------------------------------------------------------------------
+
+static bool __fix_pcreladdr(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
+                            context* ctxp) {
+    // Load a PC-relative address into a register
+    // http://infocenter.arm.com/help/topic/com.arm.doc.100069_0608_00_en/pge1427897645644.html
+    static constexpr uint32_t msb = 8u;
+    static constexpr uint32_t lsb = 5u;
+    static constexpr uint32_t mask = 0x9f000000u;     // 0b10011111000000000000000000000000
+    static constexpr uint32_t rmask = 0x0000001fu;    // 0b00000000000000000000000000011111
+    static constexpr uint32_t lmask = 0xff00001fu;    // 0b11111111000000000000000000011111
+    static constexpr uint32_t fmask = 0x00ffffffu;    // 0b00000000111111111111111111111111
+    static constexpr uint32_t max_val = 0x001fffffu;  // 0b00000000000111111111111111111111
+    static constexpr uint32_t op_adr = 0x10000000u;   // "adr"  Rd, ADDR_PCREL21
+    static constexpr uint32_t op_adrp = 0x90000000u;  // "adrp" Rd, ADDR_ADRP
+
+    const uint32_t ins = *(*inprwp);
+    intptr_t current_idx;
+    switch (ins & mask) {
+        case op_adr: {
+            current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
+            int64_t lsb_bytes = static_cast<uint32_t>(ins << 1u) >> 30u;
+            int64_t absolute_addr =
+                reinterpret_cast<int64_t>(*inprxp) +
+                ((static_cast<int64_t>(static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3ll) | lsb_bytes);
+            int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx));
+            bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
+            if (!special_fix_type && llabs(new_pc_offset) >= (max_val >> 1)) {
+                if ((reinterpret_cast<uint64_t>(*outprx + 2) & 7u) != 0u) {
+                    (*outprw)[0] = A64_NOP;
+                    ctxp->reset_current_ins(current_idx, ++(*outprx));
+                    ++*(outprw);
+                }  // if
+
+                (*outprw)[0] = 0x58000000u | (((8u >> 2u) << lsb) & ~mask) | (ins & rmask);  // LDR #0x8
+                (*outprw)[1] = 0x14000003u;                                                  // B #0xc
+                memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));
+                *outprw += 4;
+                *outprx += 4;
+            } else {
+                if (special_fix_type) {
+                    intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr & ~3ull);
+                    if (ref_idx <= current_idx) {
+                        new_pc_offset =
+                            static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx));
+                    } else {
+                        ctxp->insert_fix_map(ref_idx, *outprw, *outprx, lsb, fmask);
+                        new_pc_offset = 0;
+                    }  // if
+                }      // if
+
+                // the lsb_bytes will never be changed, so we can use lmask to keep it and only replace immhi
+                (*outprw)[0] = (static_cast<uint32_t>((new_pc_offset >> 2) << lsb) & fmask) | (ins & lmask);
+                ++(*outprw);
+                ++(*outprx);
+            }  // if
+        } break;
+        case op_adrp: {
+            // the result is a page address rather than a reference to an instruction, so there is nothing to fix
+            // up even if it is the page the window starts on, it is always loaded as an absolute value
+            current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
+            int64_t lsb_bytes = static_cast<uint32_t>(ins << 1u) >> 30u;
+            int64_t absolute_addr =
+                (reinterpret_cast<int64_t>(*inprxp) & ~0xfffll) +
+                (((static_cast<int64_t>(static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3ll) | lsb_bytes)
+                 << 12);
+            if ((reinterpret_cast<uint64_t>(*outprx + 2) & 7u) != 0u) {
+                (*outprw)[0] = A64_NOP;
+                ctxp->reset_current_ins(current_idx, ++(*outprx));
+                ++*(outprw);
+            }  // if
+
+            (*outprw)[0] = 0x58000000u | (((8u >> 2u) << lsb) & ~mask) | (ins & rmask);  // LDR #0x8
+            (*outprw)[1] = 0x14000003u;                                                  // B #0xc
+            memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));
+            *outprw += 4;
+            *outprx += 4;
+        } break;
+        default:
+            return false;
+    }
+
+    ctxp->process_fix_map(current_idx);
+    ++(*inprxp);
+    ++(*inprwp);
+    return true;
+}
+
+//-------------------------------------------------------------------------
+
+uintptr_t relocateInstructions(uint32_t* __restrict inprw, uint32_t* __restrict inprx, int32_t count,
+                               uint32_t* __restrict outrwp, uint32_t* __restrict outrxp) {
+    if (count <= 0 || count > A64_MAX_INSTRUCTIONS) return 0;
+
+    context ctx;
+    ctx.basep = reinterpret_cast<int64_t>(inprx);
+    ctx.endp = reinterpret_cast<int64_t>(inprx + count);
+    memset(ctx.dat, 0, sizeof(ctx.dat));
+    static_assert(sizeof(ctx.dat) / sizeof(ctx.dat[0]) == A64_MAX_INSTRUCTIONS, "please use A64_MAX_INSTRUCTIONS!");
+
+    uint32_t* const outprx_base = outrxp;
+
+    while (--count >= 0) {
+        if (__fix_branch_imm(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
+        if (__fix_cond_comp_test_branch(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
+        if (__fix_loadlit(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
+        if (__fix_pcreladdr(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
+
+        // without PC-relative offset
+        ctx.process_fix_map(ctx.get_and_set_current_index(inprx, outrxp));
+        *(outrwp++) = *(inprw++);
+        outrxp++;
+        inprx++;
+    }
+
+    static constexpr uint_fast64_t mask = 0x03ffffffu;  // 0b00000011111111111111111111111111
+    auto callback = reinterpret_cast<int64_t>(inprx);
+    auto pc_offset = static_cast<int64_t>(callback - reinterpret_cast<int64_t>(outrxp)) >> 2;
+    if (llabs(pc_offset) >= (mask >> 1)) {
+        if ((reinterpret_cast<uint64_t>(outrxp + 2) & 7u) != 0u) {
+            outrwp[0] = A64_NOP;
+            ++outrxp;
+            ++outrwp;
+        }                         // if
+        outrwp[0] = 0x58000051u;  // LDR X17, #0x8
+        outrwp[1] = 0xd61f0220u;  // BR X17
+        *reinterpret_cast<int64_t*>(outrwp + 2) = callback;
+        outrwp += 4;
+        outrxp += 4;
+    } else {
+        outrwp[0] = 0x14000000u | (pc_offset & mask);  // "B" ADDR_PCREL26
+        ++outrwp;
+        ++outrxp;
+    }  // if
+
+    // cache maintenance is left to the caller, so that batched installs only flush once
+    return (outrxp - outprx_base) * sizeof(uint32_t);
+}
+
+//-------------------------------------------------------------------------
+
+// decodes the target of a PC-relative branch or ADR, returns false for anything else
+static bool __pcrel_target(uint32_t ins, const uint32_t* pc, int64_t* target) {
+    int64_t offset;
+    if ((ins & 0x7c000000u) == 0x14000000u) {  // B/BL
+        offset = static_cast<int64_t>(static_cast<int32_t>(ins << 6) >> 4);
+    } else if ((ins & 0xff000010u) == 0x54000000u || (ins & 0x7e000000u) == 0x34000000u) {  // B.cond/CBZ/CBNZ
+        offset = static_cast<int64_t>(static_cast<int32_t>(ins << 8) >> 13) << 2;
+    } else if ((ins & 0x7e000000u) == 0x36000000u) {  // TBZ/TBNZ
+        offset = static_cast<int64_t>(static_cast<int32_t>(ins << 13) >> 18) << 2;
+    } else if ((ins & 0x9f000000u) == 0x10000000u) {  // ADR, may be the base of a jump table
+        offset = (static_cast<int64_t>(static_cast<int32_t>(ins << 8) >> 13) << 2) | ((ins >> 29) & 3u);
+    } else {
+        return false;
+    }  // if
+
+    *target = reinterpret_cast<int64_t>(pc) + offset;
+    return true;
+}
+
+static bool __is_terminator(uint32_t ins) {
+    return (ins & 0xfc000000u) == 0x14000000u ||  // B
+           (ins & 0xfffffc1fu) == 0xd61f0000u ||  // BR
+           (ins & 0xfffffc1fu) == 0xd65f0000u;    // RET
+}
+
+RelocationHazard findRelocationHazard(const uint32_t* window, int32_t count, const uint32_t* scan_begin,
+                                      const uint32_t* scan_end) {
+    // control leaving the window early means whatever follows is another function, or data
+    for (int32_t i = 0; i < count - 1; i++) {
+        if (__is_terminator(window[i])) return RelocationHazard::FunctionEnd;
+    }
+
+    // only the first instruction of the window stays a valid entry point once it is patched
+    const int64_t start = reinterpret_cast<int64_t>(window + 1), end = reinterpret_cast<int64_t>(window + count);
+    for (const uint32_t* pc = scan_begin; pc < scan_end; pc++) {
+        if (pc >= window && pc < window + count) continue;  // fixed up by relocateInstructions
+
+        int64_t target;
+        if (__pcrel_target(*pc, pc, &target) && target >= start && target < end)
+            return RelocationHazard::BranchIntoWindow;
+    }
+
+    return RelocationHazard::None;
+}
+
+};  // namespace skyline::inlinehook
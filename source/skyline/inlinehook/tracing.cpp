@@ -0,0 +1,208 @@
+#include "skyline/inlinehook/tracing.hpp"
+
+#include <cstring>
+
+#include "mem.h"
+#include "nn/os.hpp"
+#include "skyline/logger/Logger.hpp"
+#include "skyline/utils/call_once.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/counter.h"
+#include "skyline/nx/kernel/svc.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace skyline::inlinehook {
+
+#define TRACE_FRAME_MAGIC 0x52544b53u  // "SKTR"
+#define TRACE_DRAIN_INTERVAL_NS 20000000ull
+#define TRACE_BATCH_SIZE 0x400  // records per frame
+#define TRACE_MAX_NAME 0x100
+
+enum TraceFrameType : u16 {
+    TraceFrame_Info,     // u64 system tick frequency, sent first on every connection
+    TraceFrame_Name,     // u32 hook id followed by its name
+    TraceFrame_Records,  // TraceRecords
+};
+
+struct TraceFrameHeader {
+    u32 magic;
+    u16 type;
+    u16 reserved;
+    u32 size;  // of the payload that follows
+};
+
+static TraceRing* s_Rings;
+static const char* s_Names[TRACE_MAX_HOOKS];
+static u32 s_NameCount = 0;
+static nn::os::MutexType s_Mutex;
+static skyline::utils::Once s_MutexInit;
+
+// holds the thread's ring, or TRACE_RING_NONE if every ring was taken when it first asked
+static nn::os::TlsSlot s_RingSlot;
+static constexpr uintptr_t TRACE_RING_NONE = 1;
+
+static void lockRings() {
+    s_MutexInit.call_once([]() { nn::os::InitializeMutex(&s_Mutex, false, 0); });
+    nn::os::LockMutex(&s_Mutex);
+}
+
+// whatever the thread left in the ring is still drained, or carried over to the next thread claiming it
+static void releaseRing(uintptr_t value) {
+    if (value != 0 && value != TRACE_RING_NONE)
+        __atomic_store_n(&reinterpret_cast<TraceRing*>(value)->claimed, false, __ATOMIC_RELEASE);
+}
+
+static void sendFrame(u16 type, const void* payload, size_t size) {
+    static u8 buffer[sizeof(TraceFrameHeader) + TRACE_BATCH_SIZE * sizeof(TraceRecord)];
+
+    TraceFrameHeader header = {TRACE_FRAME_MAGIC, type, 0, static_cast<u32>(size)};
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), payload, size);
+    skyline::logger::s_Instance->SendFrame(buffer, sizeof(header) + size);
+}
+
+static void sendName(u32 id) {
+    u8 payload[sizeof(u32) + TRACE_MAX_NAME];
+    size_t length = strnlen(s_Names[id], TRACE_MAX_NAME);
+    memcpy(payload, &id, sizeof(id));
+    memcpy(payload + sizeof(id), s_Names[id], length);
+    sendFrame(TraceFrame_Name, payload, sizeof(id) + length);
+}
+
+static void drainMain(void*) {
+    static TraceRecord batch[TRACE_BATCH_SIZE];
+
+    u32 connection = 0;
+    u32 sentNames = 0;
+    while (true) {
+        nn::os::SleepThread(nn::TimeSpan::FromNanoSeconds(TRACE_DRAIN_INTERVAL_NS));
+
+        // records stay in the rings until someone reads them, rings that fill up in the meantime count drops
+        skyline::logger::Logger* logger = skyline::logger::s_Instance;
+        u32 current = logger->ConnectionId();
+        if (current == 0 || !logger->ShouldFlush()) continue;
+
+        // a new reader gets the frequency and every name again
+        if (current != connection) {
+            connection = current;
+            sentNames = 0;
+            u64 frequency = armGetSystemTickFreq();
+            sendFrame(TraceFrame_Info, &frequency, sizeof(frequency));
+        }  // if
+
+        // names go out before any record that refers to them
+        for (u32 count = __atomic_load_n(&s_NameCount, __ATOMIC_ACQUIRE); sentNames < count; sentNames++)
+            sendName(sentNames);
+
+        size_t count = 0;
+        for (size_t i = 0; i < TRACE_RING_COUNT; i++) {
+            TraceRing& ring = s_Rings[i];
+            u64 tail = ring.tail;
+            u64 head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+            for (; tail != head; tail++) {
+                batch[count++] = ring.records[tail & (TRACE_RING_SIZE - 1)];
+                if (count == TRACE_BATCH_SIZE) {
+                    sendFrame(TraceFrame_Records, batch, count * sizeof(TraceRecord));
+                    count = 0;
+                }
+            }
+            __atomic_store_n(&ring.tail, tail, __ATOMIC_RELEASE);
+
+            u64 dropped = __atomic_exchange_n(&ring.dropped, 0, __ATOMIC_RELAXED);
+            if (dropped != 0)
+                skyline::logger::s_Instance->LogFormat("[TraceRings] thread %u dropped %lu records", ring.thread,
+                                                       dropped);
+        }
+        if (count != 0) sendFrame(TraceFrame_Records, batch, count * sizeof(TraceRecord));
+    }
+}
+
+static Result initializeLocked() {
+    if (s_Rings != NULL) return 0;
+
+    auto rings = static_cast<TraceRing*>(memalign(0x1000, TRACE_RING_COUNT * sizeof(TraceRing)));
+    R_UNLESS(rings != NULL, MAKERESULT(Module_Skyline, SkylineError_TraceRingsUnavailable));
+    memset(rings, 0, TRACE_RING_COUNT * sizeof(TraceRing));
+
+    Result rc = nn::os::AllocateTlsSlot(&s_RingSlot, releaseRing);
+    if (R_FAILED(rc)) {
+        free(rings);
+        return rc;
+    }  // if
+
+    const size_t stackSize = 0x3000;
+    void* threadStack = memalign(0x1000, stackSize);
+
+    nn::os::ThreadType* thread = new nn::os::ThreadType;
+    rc = nn::os::CreateThread(thread, drainMain, NULL, threadStack, stackSize, 16, 0);
+    if (R_FAILED(rc)) {
+        nn::os::FreeTlsSlot(s_RingSlot);
+        delete thread;
+        free(threadStack);
+        free(rings);
+        return rc;
+    }  // if
+
+    __atomic_store_n(&s_Rings, rings, __ATOMIC_RELEASE);
+    nn::os::StartThread(thread);
+    return 0;
+}
+
+Result TraceRings::initialize() {
+    lockRings();
+    Result rc = initializeLocked();
+    nn::os::UnlockMutex(&s_Mutex);
+    return rc;
+}
+
+Result TraceRings::registerName(const char* name, u32* id) {
+    lockRings();
+
+    Result rc = 0;
+    if (s_NameCount < TRACE_MAX_HOOKS) {
+        s_Names[s_NameCount] = strdup(name != NULL ? name : "");
+        *id = s_NameCount;
+        __atomic_store_n(&s_NameCount, s_NameCount + 1, __ATOMIC_RELEASE);
+    } else {
+        rc = MAKERESULT(Module_Skyline, SkylineError_TraceRingsUnavailable);
+    }  // if
+
+    nn::os::UnlockMutex(&s_Mutex);
+    return rc;
+}
+
+static TraceRing* claim(TraceRing* rings) {
+    for (size_t i = 0; i < TRACE_RING_COUNT; i++) {
+        bool expected = false;
+        if (__atomic_compare_exchange_n(&rings[i].claimed, &expected, true, false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+            u64 thread = 0;
+            svcGetThreadId(&thread, CUR_THREAD_HANDLE);
+            rings[i].thread = static_cast<u32>(thread);
+            return &rings[i];
+        }  // if
+    }
+    return NULL;
+}
+
+TraceRing* TraceRings::current() {
+    TraceRing* rings = __atomic_load_n(&s_Rings, __ATOMIC_ACQUIRE);
+    if (rings == NULL) return NULL;
+
+    uintptr_t value = nn::os::GetTlsValue(s_RingSlot);
+    if (value == 0) {
+        TraceRing* ring = claim(rings);
+        value = ring != NULL ? reinterpret_cast<uintptr_t>(ring) : TRACE_RING_NONE;
+        nn::os::SetTlsValue(s_RingSlot, value);
+    }  // if
+    return value != TRACE_RING_NONE ? reinterpret_cast<TraceRing*>(value) : NULL;
+}
+
+};  // namespace skyline::inlinehook
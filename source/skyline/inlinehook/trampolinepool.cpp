@@ -0,0 +1,245 @@
+#include "skyline/inlinehook/trampolinepool.hpp"
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "skyline/inlinehook/controlledpages.hpp"
+#include "skyline/inlinehook/installstats.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/cache.h"
+#include "skyline/utils/utils.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#define PAGE_SIZE 0x1000
+
+namespace skyline::inlinehook {
+
+struct TrampolineRegion {
+    Jit jit;
+    // where the region is written. starts out as the jit's rw buffer and becomes a persistent alias of the rx pages
+    // once those are mapped, or nullptr if the alias can't be mapped and the region is sealed
+    void* rw;
+    size_t used;
+    // range written since the last flush, relative to the start of the region
+    size_t dirtyStart;
+    size_t dirtyEnd;
+    // released chunks below used, offset to size. adjacent chunks are merged
+    std::map<size_t, size_t> freeChunks;
+};
+
+static std::vector<TrampolineRegion*> s_Regions;
+
+static Result createRegion(TrampolineRegion** out, uintptr_t near) {
+    // leave a page of slack on both ends, so a near region is reachable from anywhere around near
+    void* rx_addr = NULL;
+    if (near != 0) {
+        uintptr_t addr;
+        R_TRY(locateMappableSpaceNear(&addr, TrampolinePool::REGION_SIZE, near,
+                                      TrampolinePool::BRANCH_RANGE - PAGE_SIZE));
+        rx_addr = reinterpret_cast<void*>(addr);
+    }
+
+    auto region = new TrampolineRegion();
+
+    InstallTimer timer(InstallPhase_Jit);
+    Result rc = jitCreate(&region->jit, rx_addr, TrampolinePool::REGION_SIZE);
+    if (R_FAILED(rc)) {
+        delete region;
+        return rc;
+    }
+    memset(region->jit.rw_addr, 0, region->jit.size);
+
+    region->rw = region->jit.rw_addr;
+    region->used = 0;
+    region->dirtyStart = region->jit.size;
+    region->dirtyEnd = 0;
+
+    s_Regions.push_back(region);
+    *out = region;
+    return 0;
+}
+
+static bool isReachable(TrampolineRegion* region, uintptr_t near) {
+    if (region->rw == nullptr) return false;
+    if (near == 0) return true;
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(region->jit.rx_addr);
+    uintptr_t end = start + region->jit.size;
+    uintptr_t distance = MAX(near > start ? near - start : start - near, near > end ? near - end : end - near);
+    return distance < TrampolinePool::BRANCH_RANGE;
+}
+
+static TrampolineRegion* findRegion(uintptr_t rx) {
+    for (auto region : s_Regions) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(region->jit.rx_addr);
+        if (start <= rx && rx < start + region->jit.size) return region;
+    }
+    return nullptr;
+}
+
+static void releaseChunk(TrampolineRegion* region, size_t offset, size_t size) {
+    if (size == 0) return;
+
+    // the tail goes straight back to the bump allocator, taking any free chunk it now borders with it
+    if (offset + size == region->used) {
+        region->used = offset;
+        auto last = region->freeChunks.empty() ? region->freeChunks.end() : std::prev(region->freeChunks.end());
+        if (last != region->freeChunks.end() && last->first + last->second == region->used) {
+            region->used = last->first;
+            region->freeChunks.erase(last);
+        }
+        return;
+    }
+
+    auto next = region->freeChunks.lower_bound(offset);
+    if (next != region->freeChunks.end() && offset + size == next->first) {
+        size += next->second;
+        next = region->freeChunks.erase(next);
+    }
+    if (next != region->freeChunks.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    region->freeChunks.emplace(offset, size);
+}
+
+// takes a chunk out of the free list of region, returning its offset or -1 if none is large enough
+static s64 takeFreeChunk(TrampolineRegion* region, size_t size) {
+    for (auto it = region->freeChunks.begin(); it != region->freeChunks.end(); it++) {
+        if (it->second < size) continue;
+
+        size_t offset = it->first, remaining = it->second - size;
+        region->freeChunks.erase(it);
+        if (remaining != 0) region->freeChunks.emplace(offset + size, remaining);
+        return offset;
+    }
+    return -1;
+}
+
+Result TrampolinePool::reserve(size_t size, Trampoline* out, uintptr_t near) {
+    size = ALIGN_UP(size, ALIGNMENT);
+    R_UNLESS(size <= REGION_SIZE, MAKERESULT(Module_Skyline, SkylineError_TrampolineTooLarge));
+
+    // reuse released chunks first, then newer regions are the most likely to have space left
+    TrampolineRegion* region = nullptr;
+    s64 offset = -1;
+    for (auto it = s_Regions.rbegin(); it != s_Regions.rend() && offset < 0; it++) {
+        if (isReachable(*it, near) && (offset = takeFreeChunk(*it, size)) >= 0) region = *it;
+    }
+    for (auto it = s_Regions.rbegin(); it != s_Regions.rend() && region == nullptr; it++) {
+        if ((*it)->jit.size - (*it)->used >= size && isReachable(*it, near)) region = *it;
+    }
+    if (region == nullptr) {
+        R_TRY(createRegion(&region, near));
+    }
+
+    if (offset < 0) {
+        offset = region->used;
+        region->used += size;
+    }
+
+    out->rx = reinterpret_cast<uint32_t*>(reinterpret_cast<uintptr_t>(region->jit.rx_addr) + offset);
+    out->rw = reinterpret_cast<uint32_t*>(reinterpret_cast<uintptr_t>(region->rw) + offset);
+    out->size = size;
+
+    region->dirtyStart = MIN(region->dirtyStart, static_cast<size_t>(offset));
+    region->dirtyEnd = MAX(region->dirtyEnd, offset + size);
+    return 0;
+}
+
+void TrampolinePool::commit(Trampoline* trampoline, size_t used) {
+    used = ALIGN_UP(used, ALIGNMENT);
+    if (used >= trampoline->size) return;
+
+    TrampolineRegion* region = findRegion(reinterpret_cast<uintptr_t>(trampoline->rx));
+    if (region == nullptr) return;
+    size_t offset = reinterpret_cast<uintptr_t>(trampoline->rx) - reinterpret_cast<uintptr_t>(region->jit.rx_addr);
+
+    releaseChunk(region, offset + used, trampoline->size - used);
+    trampoline->size = used;
+}
+
+void TrampolinePool::release(Trampoline* trampoline) {
+    TrampolineRegion* region = findRegion(reinterpret_cast<uintptr_t>(trampoline->rx));
+    if (region == nullptr) return;
+    size_t offset = reinterpret_cast<uintptr_t>(trampoline->rx) - reinterpret_cast<uintptr_t>(region->jit.rx_addr);
+
+    releaseChunk(region, offset, trampoline->size);
+    *trampoline = {};
+}
+
+Result TrampolinePool::write(void* rx, const void* data, size_t size) {
+    TrampolineRegion* region = findRegion(reinterpret_cast<uintptr_t>(rx));
+    R_UNLESS(region != nullptr, MAKERESULT(Module_Libnx, LibnxError_BadInput));
+    R_UNLESS(region->rw != nullptr, MAKERESULT(Module_Skyline, SkylineError_TrampolineSealed));
+
+    size_t offset = reinterpret_cast<uintptr_t>(rx) - reinterpret_cast<uintptr_t>(region->jit.rx_addr);
+    void* rw = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(region->rw) + offset);
+    if (size == sizeof(u64) && (offset & (sizeof(u64) - 1)) == 0)
+        __atomic_store_n(static_cast<u64*>(rw), *static_cast<const u64*>(data), __ATOMIC_RELEASE);
+    else
+        memcpy(rw, data, size);
+
+    region->dirtyStart = MIN(region->dirtyStart, offset);
+    region->dirtyEnd = MAX(region->dirtyEnd, offset + size);
+    return 0;
+}
+
+// maps a region's rx pages for the first time. on CodeMemory that hides the jit's rw buffer, so from then on the
+// region is written through a persistent alias of the rx pages, it is never unmapped while hooks may run through it
+static Result makeExecutable(TrampolineRegion* region) {
+    {
+        InstallTimer timer(InstallPhase_Jit);
+        R_TRY(jitTransitionToExecutable(&region->jit));
+    }
+    if (region->jit.type != JitType_CodeMemory) return 0;
+
+    uintptr_t rw;
+    if (R_SUCCEEDED(mapPersistentAlias(reinterpret_cast<uintptr_t>(region->jit.rx_addr), region->jit.size, &rw)))
+        region->rw = reinterpret_cast<void*>(rw);
+    else
+        region->rw = nullptr;
+    return 0;
+}
+
+Result TrampolinePool::flush() {
+    for (auto region : s_Regions) {
+        if (region->dirtyStart >= region->dirtyEnd) {
+            if (!region->jit.is_executable) R_TRY(makeExecutable(region));
+            continue;
+        }
+
+        void* rw = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(region->rw) + region->dirtyStart);
+        void* rx = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(region->jit.rx_addr) + region->dirtyStart);
+        size_t size = region->dirtyEnd - region->dirtyStart;
+
+        // write back through the rw alias, then invalidate the rx alias once the code is mapped
+        {
+            InstallTimer timer(InstallPhase_Cache);
+            armDCacheFlush(rw, size);
+        }
+        if (!region->jit.is_executable) R_TRY(makeExecutable(region));
+        {
+            InstallTimer timer(InstallPhase_Cache);
+            armICacheInvalidate(rx, size);
+        }
+
+        region->dirtyStart = region->jit.size;
+        region->dirtyEnd = 0;
+    }
+
+    return 0;
+}
+
+};  // namespace skyline::inlinehook
@@ -5,6 +5,7 @@
 #include "alloc.h"
 #include "mem.h"
 #include "operator.h"
+#include "skyline/utils/call_once.hpp"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,15 @@ Logger* s_Instance;
 
 std::queue<char*>* g_msgQueue = nullptr;
 
+// held for every send of Flush and SendFrame, so binary frames never land inside a message
+static nn::os::MutexType g_sendMutex;
+static skyline::utils::Once g_sendMutexInit;
+
+static void lockSend() {
+    g_sendMutexInit.call_once([]() { nn::os::InitializeMutex(&g_sendMutex, false, 0); });
+    nn::os::LockMutex(&g_sendMutex);
+}
+
 void ThreadMain(void* arg) {
     Logger* t = (Logger*)arg;
 
@@ -71,10 +81,17 @@ bool Logger::ShouldFlush() {
     return true;
 }
 
+void Logger::SendFrame(const void* data, size_t size) {
+    lockSend();
+    SendRaw(const_cast<void*>(data), size);
+    nn::os::UnlockMutex(&g_sendMutex);
+}
+
 void Logger::Flush() {
     if (!this->ShouldFlush()) return;
     if (!g_msgQueue) return;
 
+    lockSend();
     while (!g_msgQueue->empty()) {
         auto data = g_msgQueue->front();
 
@@ -82,6 +99,7 @@ void Logger::Flush() {
         delete[] data;
         g_msgQueue->pop();
     }
+    nn::os::UnlockMutex(&g_sendMutex);
 }
 
 void Logger::Log(const char* data, size_t size) {
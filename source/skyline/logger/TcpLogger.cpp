@@ -11,6 +11,7 @@ void skyline_tcp_send_raw(char* data, u64 size) { skyline::logger::s_Instance->L
 namespace skyline::logger {
 int g_tcpSocket = -1;
 bool g_loggerInit = false;
+u32 g_tcpConnection = 0;  // counts the clients accepted so far
 
 Result stub(){
     return 0;
@@ -39,7 +40,8 @@ void init_socket_thing() {
 
     u32 addrLen;
     g_tcpSocket = nn::socket::Accept(g_tcpSocket, (struct sockaddr*)&serverAddr, &addrLen);
-    
+    if (g_tcpSocket >= 0) __atomic_add_fetch(&g_tcpConnection, 1, __ATOMIC_RELEASE);
+
     char* message = "TCP Socket Connnected.\n";
     nn::socket::Send(g_tcpSocket, (void*)message, strlen(message), 0);
 }
@@ -99,7 +101,10 @@ bool TcpLogger::ShouldFlush() {
     return g_loggerInit && (g_tcpSocket != -1);
 }
 
+u32 TcpLogger::ConnectionId() { return ShouldFlush() ? __atomic_load_n(&g_tcpConnection, __ATOMIC_ACQUIRE) : 0; }
+
 void TcpLogger::SendRaw(void* data, size_t size) {
+    if (g_tcpSocket < 0) return;
     nn::socket::Send(g_tcpSocket, data, size, 0);
 }
 };  // namespace skyline::logger
@@ -1,6 +1,7 @@
 #include "skyline/plugin/PluginManager.hpp"
 
 #include "nn/crypto.h"
+#include "skyline/inlinehook/deferred.hpp"
 #include "skyline/logger/TcpLogger.hpp"
 #include "skyline/utils/utils.h"
 
@@ -113,6 +114,9 @@ namespace plugin {
         }
         m_loadedPluginCount = totalPluginCount;
 
+        // hooks the plugins deferred in main on symbols that are already loaded
+        inlinehook::DeferredHooks::resolve();
+
         m_isLoading = false;
         if (m_queuePluginLoad) {
             // A plugin has requested to load other modules in its main()
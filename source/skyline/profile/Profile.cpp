@@ -0,0 +1,40 @@
+#include "skyline/profile/Profile.hpp"
+
+#include "skyline/inlinehook/tracing.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/counter.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+using skyline::inlinehook::TraceRing;
+using skyline::inlinehook::TraceRings;
+
+// zones are recorded through the same rings as traced hooks, and share their ids
+static inline void record(u32 id) {
+    TraceRing* ring = TraceRings::current();
+    if (ring != NULL) TraceRings::push(ring, armGetSystemTick(), id);
+}
+
+Result skyline_profile_start() { return TraceRings::initialize(); }
+
+u32 skyline_profile_register_zone(const char* name) {
+    u32 id;
+    if (R_FAILED(TraceRings::registerName(name, &id))) return skyline::profile::INVALID_ZONE;
+    return id;
+}
+
+void skyline_profile_begin(u32 zone) {
+    if (zone != skyline::profile::INVALID_ZONE) record(zone);
+}
+
+void skyline_profile_end(u32 zone) {
+    if (zone != skyline::profile::INVALID_ZONE) record(zone | TRACE_RECORD_EXIT);
+}
+
+void skyline_profile_frame() { record(TRACE_RECORD_FRAME); }
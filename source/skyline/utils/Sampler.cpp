@@ -0,0 +1,124 @@
+#include "skyline/utils/Sampler.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace skyline::utils {
+
+Sampler::Sampler(ThreadContextSource* source, Symbolizer symbolizer)
+    : m_source(source), m_symbolizer(std::move(symbolizer)) {}
+
+void Sampler::setModules(std::vector<SampledModule> modules) {
+    std::sort(modules.begin(), modules.end(),
+              [](const SampledModule& a, const SampledModule& b) { return a.start < b.start; });
+    m_modules = std::move(modules);
+}
+
+size_t Sampler::walk(u64 id, const SampledContext& context, uintptr_t* frames) {
+    size_t count = 0;
+    frames[count++] = context.pc;
+
+    // frame records are {previous fp, return address}, and each one sits higher up the stack than the last. an fp
+    // outside of the live part of the stack isn't a frame record, the code holding it doesn't keep frame pointers
+    uintptr_t fp = context.fp;
+    while (count < MAX_FRAMES && (fp & 7) == 0 && fp >= context.sp && fp + 16 <= context.stack_end) {
+        u64 next, ret;
+        if (!m_source->readStack(id, fp, &next) || !m_source->readStack(id, fp + 8, &ret) || ret == 0) break;
+
+        // the return address is past the call, step back so it is attributed to the caller
+        frames[count++] = ret - 4;
+        if (next <= fp) break;
+        fp = next;
+    }
+    return count;
+}
+
+void Sampler::sample() {
+    u64 ids[MAX_THREADS];
+    size_t count = m_source->listThreads(ids, MAX_THREADS);
+
+    for (size_t i = 0; i < count; i++) {
+        SampledContext context;
+        if (!m_source->suspend(ids[i], &context)) continue;
+
+        uintptr_t frames[MAX_FRAMES];
+        size_t depth = walk(ids[i], context, frames);
+        m_source->resume(ids[i]);
+
+        ThreadProfile& profile = m_threads[ids[i]];
+        if (profile.samples++ == 0) profile.name = m_source->threadName(ids[i]);
+        profile.modules[findModule(frames[0])]++;
+        profile.stacks[std::vector<uintptr_t>(frames, frames + depth)]++;
+    }
+}
+
+size_t Sampler::findModule(uintptr_t address) const {
+    auto it = std::upper_bound(m_modules.begin(), m_modules.end(), address,
+                               [](uintptr_t addr, const SampledModule& module) { return addr < module.start; });
+    if (it == m_modules.begin() || address >= (it - 1)->end) return m_modules.size();
+    return it - 1 - m_modules.begin();
+}
+
+// folded stacks use ';' between frames and a space before the count, keep both out of names
+static void sanitize(std::string* name) { std::replace(name->begin(), name->end(), ';', ':'); }
+
+std::string Sampler::frameName(uintptr_t address) {
+    char buffer[0x40];
+    size_t index = findModule(address);
+    if (index == m_modules.size()) {
+        snprintf(buffer, sizeof(buffer), "0x%" PRIxPTR, address);
+        return buffer;
+    }
+
+    const SampledModule& module = m_modules[index];
+    std::string name;
+    if (m_symbolizer && m_symbolizer(address, module, &name)) {
+        sanitize(&name);
+        return module.name + "!" + name;
+    }
+
+    snprintf(buffer, sizeof(buffer), "+0x%" PRIxPTR, address - module.start);
+    return module.name + buffer;
+}
+
+void Sampler::report(const std::function<void(const std::string& line)>& emit) {
+    // frames are symbolized once per report, many stacks share them
+    std::map<uintptr_t, std::string> names;
+    auto nameOf = [&](uintptr_t address) -> const std::string& {
+        auto it = names.find(address);
+        if (it == names.end()) it = names.emplace(address, frameName(address)).first;
+        return it->second;
+    };
+
+    char buffer[0x80];
+    for (auto& [id, profile] : m_threads) {
+        std::string thread = profile.name.empty() ? std::to_string(id) : profile.name;
+        sanitize(&thread);
+        std::replace(thread.begin(), thread.end(), ' ', '_');
+
+        std::string summary = "# " + thread;
+        snprintf(buffer, sizeof(buffer), ": %" PRIu64 " samples", profile.samples);
+        summary += buffer;
+        for (auto& [module, samples] : profile.modules) {
+            const char* name = module == m_modules.size() ? "unknown" : m_modules[module].name.c_str();
+            snprintf(buffer, sizeof(buffer), ", %s %" PRIu64 " (%.1f%%)", name, samples,
+                     100.0 * samples / profile.samples);
+            summary += buffer;
+        }
+        emit(summary);
+
+        // different addresses in the same function fold into one line
+        std::map<std::string, u64> folded;
+        for (auto& [stack, samples] : profile.stacks) {
+            std::string line = thread;
+            for (size_t i = stack.size(); i-- > 0;) line += ";" + nameOf(stack[i]);
+            folded[line] += samples;
+        }
+        for (auto& [line, samples] : folded) emit(line + " " + std::to_string(samples));
+    }
+
+    m_threads.clear();
+}
+
+};  // namespace skyline::utils
@@ -0,0 +1,267 @@
+#include "skyline/utils/SamplingProfiler.hpp"
+
+#include <algorithm>
+
+#include "mem.h"
+#include "nn/os.hpp"
+#include "skyline/inlinehook/And64InlineHook.hpp"
+#include "skyline/logger/Logger.hpp"
+#include "skyline/plugin/PluginManager.hpp"
+#include "skyline/utils/Sampler.hpp"
+#include "skyline/utils/SymbolMap.hpp"
+#include "skyline/utils/call_once.hpp"
+#include "skyline/utils/cpputils.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/arm/counter.h"
+#include "skyline/nx/arm/thread_context.h"
+#include "skyline/nx/kernel/svc.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace skyline::utils::SamplingProfiler {
+
+static constexpr u32 MAX_RATE_HZ = 1000;
+
+// every nn::os thread started since trackThreads, identified by its ThreadType
+static nn::os::ThreadType* s_Threads[Sampler::MAX_THREADS];
+static size_t s_ThreadCount = 0;
+static nn::os::MutexType s_ThreadsMutex;
+static Once s_ThreadsInit;
+
+static void (*startThreadImpl)(nn::os::ThreadType*);
+static void (*destroyThreadImpl)(nn::os::ThreadType*);
+
+static void lockThreads() {
+    s_ThreadsInit.call_once([]() { nn::os::InitializeMutex(&s_ThreadsMutex, false, 0); });
+    nn::os::LockMutex(&s_ThreadsMutex);
+}
+
+static void addThread(nn::os::ThreadType* thread) {
+    lockThreads();
+    if (std::find(s_Threads, s_Threads + s_ThreadCount, thread) == s_Threads + s_ThreadCount &&
+        s_ThreadCount < Sampler::MAX_THREADS)
+        s_Threads[s_ThreadCount++] = thread;
+    nn::os::UnlockMutex(&s_ThreadsMutex);
+}
+
+static void handleStartThread(nn::os::ThreadType* thread) {
+    addThread(thread);
+    startThreadImpl(thread);
+}
+
+// waits for a sample in progress, the ThreadType may be freed right after this
+static void handleDestroyThread(nn::os::ThreadType* thread) {
+    lockThreads();
+    auto end = std::remove(s_Threads, s_Threads + s_ThreadCount, thread);
+    s_ThreadCount = end - s_Threads;
+    nn::os::UnlockMutex(&s_ThreadsMutex);
+
+    destroyThreadImpl(thread);
+}
+
+static Once s_TrackingInit;
+
+void trackThreads() {
+    s_TrackingInit.call_once([]() {
+        addThread(nn::os::GetCurrentThread());
+
+        const HookSpec hooks[] = {
+            {reinterpret_cast<void*>(nn::os::StartThread), reinterpret_cast<void*>(handleStartThread),
+             (void**)&startThreadImpl},
+            {reinterpret_cast<void*>(nn::os::DestroyThread), reinterpret_cast<void*>(handleDestroyThread),
+             (void**)&destroyThreadImpl},
+        };
+        A64HookFunctionBatch(hooks, sizeof(hooks) / sizeof(hooks[0]));
+    });
+}
+
+//-------------------------------------------------------------------------
+
+// pauses tracked threads through svcSetThreadActivity and reads them with svcGetThreadContext3. the caller holds
+// s_ThreadsMutex, so no thread can be destroyed while it is sampled
+class SvcThreadSource : public ThreadContextSource {
+   public:
+    size_t listThreads(u64* ids, size_t max) override {
+        nn::os::ThreadType* self = nn::os::GetCurrentThread();
+        size_t count = 0;
+        for (size_t i = 0; i < s_ThreadCount && count < max; i++) {
+            if (s_Threads[i] != self) ids[count++] = reinterpret_cast<u64>(s_Threads[i]);
+        }
+        return count;
+    }
+
+    std::string threadName(u64 id) override {
+        const char* name = nn::os::GetThreadNamePointer(reinterpret_cast<nn::os::ThreadType*>(id));
+        return name != nullptr ? name : "";
+    }
+
+    bool suspend(u64 id, SampledContext* context) override {
+        Handle handle = reinterpret_cast<nn::os::ThreadType*>(id)->Handle;
+        if (R_FAILED(svcSetThreadActivity(handle, true))) return false;
+
+        // fails for a thread that is still running on another core, it is simply not sampled this time
+        ThreadContext threadContext;
+        if (R_FAILED(svcGetThreadContext3(&threadContext, handle))) {
+            svcSetThreadActivity(handle, false);
+            return false;
+        }
+
+        auto thread = reinterpret_cast<nn::os::ThreadType*>(id);
+        context->pc = threadContext.pc.x;
+        context->lr = threadContext.lr;
+        context->fp = threadContext.fp;
+        context->sp = threadContext.sp;
+        context->stack_end = reinterpret_cast<uintptr_t>(thread->Stack) + thread->StackSize;
+        return true;
+    }
+
+    void resume(u64 id) override { svcSetThreadActivity(reinterpret_cast<nn::os::ThreadType*>(id)->Handle, false); }
+
+    bool readStack(u64 id, uintptr_t address, u64* value) override {
+        auto thread = reinterpret_cast<nn::os::ThreadType*>(id);
+        uintptr_t start = reinterpret_cast<uintptr_t>(thread->Stack);
+        if (address < start || address + sizeof(u64) > start + thread->StackSize) return false;
+
+        *value = *reinterpret_cast<const u64*>(address);
+        return true;
+    }
+};
+
+//-------------------------------------------------------------------------
+
+static std::string baseName(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// NSOs are mapped in load order: rtld, main, subsdk0-9 (skyline among them), then sdk
+static std::vector<SampledModule> collectModules() {
+    std::vector<std::pair<uintptr_t, uintptr_t>> texts;
+    MemoryInfo info;
+    u32 pageInfo;
+    for (u64 addr = 0; R_SUCCEEDED(svcQueryMemory(&info, &pageInfo, addr));) {
+        if ((info.type & 0xff) == MemType_CodeStatic && (info.perm & Perm_Rx) == Perm_Rx)
+            texts.emplace_back(info.addr, info.addr + info.size);
+
+        // wraps around past the end of the address space
+        if (info.addr + info.size <= addr) break;
+        addr = info.addr + info.size;
+    }
+
+    std::vector<SampledModule> modules;
+    auto main = std::find_if(texts.begin(), texts.end(), [](auto& text) { return text.first == g_MainTextAddr; });
+    if (main != texts.end()) {
+        if (main != texts.begin()) modules.push_back({"rtld", (main - 1)->first, (main - 1)->second});
+        modules.push_back({"main", main->first, main->second});
+        for (auto it = main + 1; it != texts.end(); it++) {
+            std::string name = it + 1 == texts.end() ? "sdk" : "subsdk" + std::to_string(it - main - 1);
+            modules.push_back({name, it->first, it->second});
+        }
+    }
+
+    for (auto& plugin : plugin::Manager::GetPlugins()) {
+        if (plugin.Module.ModuleObject == nullptr) continue;
+        uintptr_t start = plugin.Module.ModuleObject->module_base;
+        modules.push_back({baseName(plugin.Path), start, start + plugin.Size});
+    }
+    return modules;
+}
+
+// the symbol maps cover the main module, the other modules only name their exports
+static bool symbolize(uintptr_t address, const SampledModule& module, std::string* out) {
+    uintptr_t offset;
+    return SymbolMap::symbolize(address, out, &offset);
+}
+
+//-------------------------------------------------------------------------
+
+static SvcThreadSource s_Source;
+static Sampler* s_Sampler;
+static nn::os::ThreadType* s_ProfilerThread;
+static void* s_ProfilerStack;
+static bool s_Running = false;
+static u32 s_RateHz;
+static u32 s_ReportIntervalMs;
+
+static void report() {
+    s_Sampler->report([](const std::string& line) {
+        skyline::logger::s_Instance->LogFormat("[SamplingProfiler] %s", line.c_str());
+    });
+}
+
+static void profilerMain(void*) {
+    const u64 reportTicks = armNsToTicks(s_ReportIntervalMs * 1000000ull);
+    u64 lastReport = armGetSystemTick();
+
+    while (__atomic_load_n(&s_Running, __ATOMIC_ACQUIRE)) {
+        nn::os::SleepThread(nn::TimeSpan::FromNanoSeconds(1000000000ull / s_RateHz));
+
+        lockThreads();
+        s_Sampler->sample();
+        nn::os::UnlockMutex(&s_ThreadsMutex);
+
+        if (armGetSystemTick() - lastReport >= reportTicks) {
+            report();
+            lastReport = armGetSystemTick();
+        }
+    }
+
+    report();
+}
+
+Result start(u32 rateHz, u32 reportIntervalMs) {
+    R_UNLESS(rateHz != 0 && rateHz <= MAX_RATE_HZ, MAKERESULT(Module_Skyline, SkylineError_InvalidProfilerRate));
+    if (s_Running) return 0;
+
+    // threads started before this are only known if a plugin asked for tracking earlier on
+    trackThreads();
+    if (s_Sampler == nullptr) s_Sampler = new Sampler(&s_Source, symbolize);
+    s_Sampler->setModules(collectModules());
+    s_RateHz = rateHz;
+    s_ReportIntervalMs = reportIntervalMs;
+    s_Running = true;
+
+    const size_t stackSize = 0x8000;
+    s_ProfilerStack = memalign(0x1000, stackSize);
+
+    // above the game's threads, so samples are taken on time
+    s_ProfilerThread = new nn::os::ThreadType;
+    Result rc = nn::os::CreateThread(s_ProfilerThread, profilerMain, nullptr, s_ProfilerStack, stackSize, 8, 0);
+    if (R_FAILED(rc)) {
+        s_Running = false;
+        delete s_ProfilerThread;
+        free(s_ProfilerStack);
+        return rc;
+    }
+    nn::os::StartThread(s_ProfilerThread);
+
+    skyline::logger::s_Instance->LogFormat("[SamplingProfiler] sampling %zu threads at %u Hz", s_ThreadCount, rateHz);
+    return 0;
+}
+
+void stop() {
+    if (!s_Running) return;
+
+    __atomic_store_n(&s_Running, false, __ATOMIC_RELEASE);
+    nn::os::WaitThread(s_ProfilerThread);
+    nn::os::DestroyThread(s_ProfilerThread);
+    delete s_ProfilerThread;
+    free(s_ProfilerStack);
+    s_ProfilerThread = nullptr;
+}
+
+}  // namespace skyline::utils::SamplingProfiler
+
+void skyline_profiler_track_threads() { skyline::utils::SamplingProfiler::trackThreads(); }
+
+Result skyline_profiler_start(u32 rate_hz, u32 report_interval_ms) {
+    return skyline::utils::SamplingProfiler::start(rate_hz, report_interval_ms);
+}
+
+void skyline_profiler_stop() { skyline::utils::SamplingProfiler::stop(); }
@@ -1,38 +1,391 @@
 #include "skyline/utils/SymbolMap.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <elf.h>
+#include <memory>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
+#include "mem.h"
 #include "nn/fs.h"
+#include "nn/os.hpp"
 #include "skyline/logger/Logger.hpp"
+#include "skyline/utils/call_once.hpp"
 #include "skyline/utils/cpputils.hpp"
+#include "skyline/utils/utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "skyline/nx/kernel/svc.h"
+
+#ifdef __cplusplus
+}
+#endif
 
 namespace skyline::utils::SymbolMap {
 
 static constexpr auto MAP_DIR_PATH = "skyline/maps/3AB632DEE82D59448599B2291F30994A";
 static constexpr auto MAP_PATH = "skyline/maps/3AB632DEE82D59448599B2291F30994A/unity_syms.bin";
 
-static std::unordered_map<std::string, uintptr_t> nameToAddr;
+// indexed maps are looked up in place, see scripts/convertSymbolMap.py for the layout. version 3 places every name
+// with a minimal perfect hash, version 2 groups them in hash buckets. both are read, only version 3 is written
+static constexpr u32 MAP_MAGIC = 0x4d534b53;  // "SKSM"
+static constexpr u32 MAP_VERSION = 3;
+static constexpr u32 MAP_VERSION_BUCKETED = 2;
+
+struct MapHeader {
+    u32 magic;
+    u32 version;
+    u32 symbolCount;
+    u32 bucketCount;  // a power of two
+    u32 symbolsOffset;
+    u32 indexOffset;  // the displacements of a v3 map, the buckets of a v2 map
+    u32 stringsOffset;
+    u32 stringsSize;
+};
+
+// v3 maps store each symbol at the slot the perfect hash gives its name, v2 maps group them by bucket
+struct MapSymbol {
+    u32 textOffset;
+    u32 nameOffset;  // into the string pool
+    u32 hash;        // low half of the name's hash, or v2's 32-bit hash. rejects most misses without a compare
+    u32 reserved;
+};
+
+// a displacement with this bit set holds the slot of its bucket's only symbol
+static constexpr u32 DISPLACEMENT_DIRECT = 0x80000000;
+
+struct Map {
+    std::unique_ptr<char[]> data;
+    const MapHeader* header;
+    const MapSymbol* symbols;
+    const u32* index;  // v3: bucketCount displacements, v2: bucketCount + 1 bucket starts
+    const char* strings;
+};
+
+static std::vector<Map> maps;
+// symbols of v1 maps, the names point into the map files, which are kept in v1Buffers
+static std::unordered_map<std::string_view, uintptr_t> nameToAddr;
+static std::vector<std::unique_ptr<char[]>> v1Buffers;
+static size_t mapSymbolCount = 0;
+
+struct ReverseEntry {
+    u32 offset;  // from the index's base
+    u32 name;    // into the index's strings, or NO_SYMBOL where a sized symbol ends
+};
+
+static constexpr u32 NO_SYMBOL = UINT32_MAX;
+
+// the symbols of one map file or module, sorted by offset
+struct ReverseIndex {
+    uintptr_t base;
+    uintptr_t end;
+    const char* strings;
+    std::vector<ReverseEntry> entries;
+};
+
+// indices are built off to the side and only added, swapped in or dropped under reverseMutex
+static std::vector<ReverseIndex> mapIndices;
+static std::vector<ReverseIndex> moduleIndices;
+static nn::os::MutexType reverseMutex;
+static Once reverseInit;
+static bool reverseReady = false;
+// the thread holding reverseMutex, so trySymbolize doesn't try to take it again from an exception handler
+static nn::os::ThreadType* reverseOwner = nullptr;
+
+static void lockReverse() {
+    reverseInit.call_once([]() {
+        nn::os::InitializeMutex(&reverseMutex, false, 0);
+        __atomic_store_n(&reverseReady, true, __ATOMIC_RELEASE);
+    });
+    nn::os::LockMutex(&reverseMutex);
+    __atomic_store_n(&reverseOwner, nn::os::GetCurrentThread(), __ATOMIC_RELAXED);
+}
+
+static void unlockReverse() {
+    __atomic_store_n(&reverseOwner, nullptr, __ATOMIC_RELAXED);
+    nn::os::UnlockMutex(&reverseMutex);
+}
+
+static void addMapIndex(std::vector<ReverseEntry> entries, const char* strings) {
+    std::sort(entries.begin(), entries.end(),
+              [](const ReverseEntry& a, const ReverseEntry& b) { return a.offset < b.offset; });
+
+    lockReverse();
+    mapIndices.push_back({g_MainTextAddr, g_MainRodataAddr, strings, std::move(entries)});
+    unlockReverse();
+}
 
-static void parse(char* buffer) {
-    s64 pos = 0;
+// hashes of names no map has, checked before any map is. direct mapped, a colliding miss simply takes the slot
+static constexpr size_t MISS_CACHE_SIZE = 0x100;
+static u64 missCache[MISS_CACHE_SIZE];
+
+static u64 hashName(std::string_view name) {
+    // FNV-1a
+    u64 hash = 0xcbf29ce484222325;
+    for (char c : name) hash = (hash ^ static_cast<u8>(c)) * 0x100000001b3;
+    return hash;
+}
+
+// the 32-bit FNV-1a v2 maps are built with
+static u32 hashNameBucketed(std::string_view name) {
+    u32 hash = 0x811c9dc5;
+    for (char c : name) hash = (hash ^ static_cast<u8>(c)) * 0x01000193;
+    return hash;
+}
+
+// murmur3's finalizer
+static u32 mix(u32 value) {
+    value ^= value >> 16;
+    value *= 0x85ebca6b;
+    value ^= value >> 13;
+    value *= 0xc2b2ae35;
+    value ^= value >> 16;
+    return value;
+}
+
+static u32 slotOf(const MapHeader* header, const u32* displacements, u64 hash) {
+    u32 displacement = displacements[static_cast<u32>(hash) & (header->bucketCount - 1)];
+    if (displacement & DISPLACEMENT_DIRECT) return displacement & ~DISPLACEMENT_DIRECT;
+    return mix(static_cast<u32>(hash >> 32) + displacement * 0x9e3779b9) % header->symbolCount;
+}
+
+static bool hasMapHeader(const char* buffer, size_t size) {
+    return size >= sizeof(MapHeader) && reinterpret_cast<const MapHeader*>(buffer)->magic == MAP_MAGIC;
+}
+
+// every offset is checked once here, so lookups can trust them
+static bool validateIndexedMap(const char* buffer, size_t size) {
+    auto header = reinterpret_cast<const MapHeader*>(buffer);
+    auto fits = [size](u64 offset, u64 length) { return offset <= size && length <= size - offset; };
+
+    u32 count = header->symbolCount;
+    bool bucketed = header->version == MAP_VERSION_BUCKETED;
+    u64 indexSize = (u64(header->bucketCount) + (bucketed ? 1 : 0)) * sizeof(u32);
+    if ((header->version != MAP_VERSION && !bucketed) || (header->bucketCount & (header->bucketCount - 1)) != 0 ||
+        header->bucketCount == 0 || !fits(header->symbolsOffset, u64(count) * sizeof(MapSymbol)) ||
+        !fits(header->indexOffset, indexSize) || !fits(header->stringsOffset, header->stringsSize) ||
+        header->stringsSize == 0 || buffer[header->stringsOffset + header->stringsSize - 1] != 0 ||
+        header->symbolsOffset % alignof(MapSymbol) || header->indexOffset % alignof(u32))
+        return false;
+
+    auto symbols = reinterpret_cast<const MapSymbol*>(buffer + header->symbolsOffset);
+    for (u32 i = 0; i < count; i++) {
+        if (symbols[i].nameOffset >= header->stringsSize) return false;
+    }
+    auto index = reinterpret_cast<const u32*>(buffer + header->indexOffset);
+    for (u32 i = 0; i < header->bucketCount; i++) {
+        if (bucketed) {
+            if (index[i] > index[i + 1] || index[i + 1] > count) return false;
+        } else if ((index[i] & DISPLACEMENT_DIRECT) && (index[i] & ~DISPLACEMENT_DIRECT) >= count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// takes a validated map, which is used straight from its buffer
+static void addIndexedMap(std::unique_ptr<char[]> data) {
+    char* buffer = data.get();
+    auto header = reinterpret_cast<const MapHeader*>(buffer);
+    Map map = {std::move(data), header, reinterpret_cast<const MapSymbol*>(buffer + header->symbolsOffset),
+               reinterpret_cast<const u32*>(buffer + header->indexOffset), buffer + header->stringsOffset};
+
+    u32 count = header->symbolCount;
+    std::vector<ReverseEntry> entries(count);
+    for (u32 i = 0; i < count; i++) entries[i] = {map.symbols[i].textOffset, map.symbols[i].nameOffset};
+    addMapIndex(std::move(entries), map.strings);
+
+    maps.push_back(std::move(map));
+    mapSymbolCount += count;
+
+    skyline::logger::s_Instance->LogFormat("[SymbolMap] Mapped %u symbols from symbol map.", count);
+}
+
+// scans the name's bucket, comparing the names whose hash matches
+static uintptr_t lookupBucketedMap(const Map& map, std::string_view name) {
+    u32 hash = hashNameBucketed(name);
+    u32 bucket = hash & (map.header->bucketCount - 1);
+    for (u32 i = map.index[bucket]; i < map.index[bucket + 1]; i++) {
+        const MapSymbol& symbol = map.symbols[i];
+        if (symbol.hash == hash && name == map.strings + symbol.nameOffset)
+            return static_cast<uintptr_t>(symbol.textOffset) + g_MainTextAddr;
+    }
+    return 0;
+}
+
+// a single compare in a v3 map, the perfect hash leaves only one candidate
+static uintptr_t lookupIndexedMap(const Map& map, std::string_view name, u64 hash) {
+    if (map.header->version == MAP_VERSION_BUCKETED) return lookupBucketedMap(map, name);
+    if (map.header->symbolCount == 0) return 0;
+
+    const MapSymbol& symbol = map.symbols[slotOf(map.header, map.index, hash)];
+    if (symbol.hash != static_cast<u32>(hash) || name != map.strings + symbol.nameOffset) return 0;
+    return static_cast<uintptr_t>(symbol.textOffset) + g_MainTextAddr;
+}
+
+// files are read in chunks of this size, v1 records are parsed as soon as they were read in full
+static constexpr size_t READ_CHUNK_SIZE = 0x100000;
+// the application cores
+static constexpr size_t MAX_LOADERS = 3;
+
+// one map file, read by whichever loader thread takes it. they are merged in directory order once all are read
+struct MapFile {
+    std::string path;
+    size_t size;
+    std::unique_ptr<char[]> buffer;
+    bool loaded;
+    bool indexed;
+    // v1 maps, the names point into buffer
+    std::vector<std::pair<std::string_view, uintptr_t>> symbols;
+    std::vector<ReverseEntry> entries;
+};
+
+enum LoadState : u32 {
+    LoadState_Idle,
+    LoadState_Loading,
+    LoadState_Done,
+};
+
+static std::vector<MapFile> mapFiles;
+static size_t nextMapFile = 0;
+static u32 loadState = LoadState_Idle;
+static nn::os::EventType loadedEvent;
+
+// parses every v1 record that is in the first read bytes, returning where the first one that is not starts
+static size_t parseV1(MapFile* file, size_t pos, size_t read) {
+    const char* buffer = file->buffer.get();
     s32 symCount = 0;
     memcpy(&symCount, buffer, 4);
-    pos += 4;
 
-    for (int i = 0; i < symCount; i++) {
+    while (file->symbols.size() < static_cast<size_t>(MAX(symCount, 0)) && pos + 4 < read) {
+        const char* name = buffer + pos + 4;
+        auto end = static_cast<const char*>(memchr(name, 0, read - pos - 4));
+        if (end == nullptr) break;
+
         s32 offset = 0;
         memcpy(&offset, buffer + pos, 4);
-        pos += 4;
-        auto str = std::string(buffer + pos);
-        pos += str.length() + 1;
-
+        if (offset >= 0) file->entries.push_back({static_cast<u32>(offset), static_cast<u32>(pos + 4)});
         uintptr_t absoluteAddr = static_cast<uintptr_t>(offset) + g_MainTextAddr;
-        nameToAddr[str] = absoluteAddr;
+        file->symbols.emplace_back(std::string_view(name, end - name), absoluteAddr);
+        pos = end + 1 - buffer;
+    }
+    return pos;
+}
+
+static void loadFile(MapFile* file) {
+    skyline::logger::Logger* logger = skyline::logger::s_Instance;
+
+    nn::fs::FileHandle handle;
+    Result rc = nn::fs::OpenFile(&handle, file->path.c_str(), nn::fs::OpenMode_Read);
+    if (R_FAILED(rc)) {
+        logger->LogFormat("[SymbolMap] Failed to open file %s. Code: %d", file->path.c_str(), rc);
+        return;
     }
 
-    skyline::logger::s_Instance->LogFormat("[SymbolMap] Read %d symbols from symbol map.", symCount);
+    logger->LogFormat("[SymbolMap] Loading symbol map file: \"%s\"", file->path.c_str());
+
+    file->buffer.reset(new char[file->size + 1]);
+    char* buffer = file->buffer.get();
+    buffer[file->size] = 0;  // Null-terminate
+
+    size_t pos = 4;
+    for (size_t read = 0; read < file->size;) {
+        size_t chunk = MIN(READ_CHUNK_SIZE, file->size - read);
+        rc = nn::fs::ReadFile(handle, read, buffer + read, chunk);
+        if (R_FAILED(rc)) {
+            logger->LogFormat("[SymbolMap] Failed to read symbol map file. Code: %d", rc);
+            nn::fs::CloseFile(handle);
+            return;
+        }
+
+        // the first chunk holds the whole header
+        if (read == 0) file->indexed = hasMapHeader(buffer, file->size);
+        read += chunk;
+        // once everything is read, the terminator after the buffer ends the last name
+        if (!file->indexed) pos = parseV1(file, pos, read == file->size ? read + 1 : read);
+    }
+    nn::fs::CloseFile(handle);
+
+    file->loaded = !file->indexed || validateIndexedMap(buffer, file->size);
+    if (!file->loaded) logger->LogFormat("[SymbolMap] Symbol map file '%s' is malformed or outdated, skipping.",
+                                         file->path.c_str());
+}
+
+static void loaderMain(void*) {
+    size_t i;
+    while ((i = __atomic_fetch_add(&nextMapFile, 1, __ATOMIC_RELAXED)) < mapFiles.size()) loadFile(&mapFiles[i]);
+}
+
+static void mergeMapFiles() {
+    size_t v1Count = 0;
+    for (auto& file : mapFiles) {
+        if (file.loaded && !file.indexed) v1Count += file.symbols.size();
+    }
+    nameToAddr.reserve(nameToAddr.size() + v1Count);
+
+    // later files win, like they did when maps were loaded one after another
+    for (auto& file : mapFiles) {
+        if (!file.loaded) continue;
+        if (file.indexed) {
+            addIndexedMap(std::move(file.buffer));
+            continue;
+        }
+
+        for (auto& [name, address] : file.symbols) nameToAddr[name] = address;
+        addMapIndex(std::move(file.entries), file.buffer.get());
+        v1Buffers.push_back(std::move(file.buffer));
+
+        skyline::logger::s_Instance->LogFormat("[SymbolMap] Read %zu symbols from symbol map.", file.symbols.size());
+    }
+    mapFiles.clear();
+
+    // names that missed before may be in the new maps
+    for (auto& miss : missCache) __atomic_store_n(&miss, 0, __ATOMIC_RELAXED);
+
+    if (nameToAddr.size() == 0 && mapSymbolCount == 0) {
+        skyline::logger::s_Instance->LogFormat(
+            "[SymbolMap] The symbol map was parsed without errors, but no symbols were added.");
+    }
+}
+
+// reads the files on up to MAX_LOADERS threads, this one included, then merges them
+static void coordinatorMain(void*) {
+    const size_t stackSize = 0x4000;
+    nn::os::ThreadType* loaders[MAX_LOADERS - 1];
+    void* stacks[MAX_LOADERS - 1];
+    size_t loaderCount = 0;
+
+    for (size_t i = 1; i < MIN(mapFiles.size(), MAX_LOADERS); i++) {
+        stacks[loaderCount] = memalign(0x1000, stackSize);
+        loaders[loaderCount] = new nn::os::ThreadType;
+        if (R_FAILED(nn::os::CreateThread(loaders[loaderCount], loaderMain, nullptr, stacks[loaderCount], stackSize,
+                                          16, i))) {
+            delete loaders[loaderCount];
+            free(stacks[loaderCount]);
+            break;
+        }
+        nn::os::StartThread(loaders[loaderCount++]);
+    }
+
+    loaderMain(nullptr);
+
+    for (size_t i = 0; i < loaderCount; i++) {
+        nn::os::WaitThread(loaders[i]);
+        nn::os::DestroyThread(loaders[i]);
+        delete loaders[i];
+        free(stacks[i]);
+    }
+
+    mergeMapFiles();
+
+    __atomic_store_n(&loadState, LoadState_Done, __ATOMIC_RELEASE);
+    nn::os::SignalEvent(&loadedEvent);
 }
 
 bool hasMapFileExtension(char* fileName) {
@@ -44,8 +397,8 @@ bool hasMapFileExtension(char* fileName) {
     return strcmp(extension, ".bin") == 0;
 }
 
-bool tryLoad() {
-    std::string path = skyline::utils::g_RomMountStr + MAP_PATH;
+// lists the map files to load, returning false if there are none
+static bool findMapFiles() {
     std::string dirPath = skyline::utils::g_RomMountStr + MAP_DIR_PATH;
     skyline::logger::Logger* logger = skyline::logger::s_Instance;
     Result rc = 0;
@@ -60,68 +413,253 @@ bool tryLoad() {
     rc = nn::fs::GetDirectoryEntryCount(&entryCount, dirHandle);
     if (R_FAILED(rc)) {
         logger->LogFormat("[SymbolMap] Failed to get directory entry count. Code: %d", rc);
+        nn::fs::CloseDirectory(dirHandle);
         return false;
     }
 
     auto entryBuffer = new nn::fs::DirectoryEntry[entryCount];
     s64 outEntryCount;
     rc = nn::fs::ReadDirectory(&outEntryCount, entryBuffer, dirHandle, entryCount);
+    nn::fs::CloseDirectory(dirHandle);
     if (R_FAILED(rc)) {
         logger->LogFormat("[SymbolMap] Failed to get directory entries. Code: %d", rc);
+        delete[] entryBuffer;
         return false;
     }
 
     for (int i = 0; i < outEntryCount; i++) {
-        nn::fs::DirectoryEntry entry = entryBuffer[i];
+        nn::fs::DirectoryEntry& entry = entryBuffer[i];
         if (!hasMapFileExtension(entry.name) || entry.type != nn::fs::DirectoryEntryType_File) {
             continue;
         }
 
         if (entry.fileSize < 4) {
             logger->LogFormat("[SymbolMap] File size of '%s' empty or too small!", entry.name);
-            return false;
+            continue;
         }
 
-        std::string entryPath = dirPath + "/" + std::string(entry.name);
+        mapFiles.push_back({});
+        mapFiles.back().path = dirPath + "/" + std::string(entry.name);
+        mapFiles.back().size = entry.fileSize;
+    }
+    delete[] entryBuffer;
 
-        nn::fs::FileHandle handle;
-        rc = nn::fs::OpenFile(&handle, entryPath.c_str(), nn::fs::OpenMode_Read);
-        if (R_FAILED(rc)) {
-            // Assume that the file doesn't exist and do nothing
-            logger->LogFormat("[SymbolMap] Failed to open file %s. Code: %d", entryPath.c_str(), rc);
-            return false;
-        }
+    return !mapFiles.empty();
+}
 
-        logger->LogFormat("[SymbolMap] Loading symbol map file: \"%s\"", entryPath.c_str());    
+bool startLoad() {
+    if (loadState != LoadState_Idle) return true;
+    if (!findMapFiles()) return false;
 
-        char* fileBuffer = new char[entry.fileSize + 1];
-        rc = nn::fs::ReadFile(handle, 0, fileBuffer, entry.fileSize);
-        if (R_FAILED(rc)) {
-            logger->LogFormat("[SymbolMap] Failed to read symbol map file. Code: %d", rc);
-            delete[] fileBuffer;
-            return false;
+    nn::os::InitializeEvent(&loadedEvent, false, nn::os::EventClearMode_ManualClear);
+    nextMapFile = 0;
+    __atomic_store_n(&loadState, LoadState_Loading, __ATOMIC_RELEASE);
+
+    const size_t stackSize = 0x4000;
+    void* stack = memalign(0x1000, stackSize);
+    auto thread = new nn::os::ThreadType;
+    if (R_FAILED(nn::os::CreateThread(thread, coordinatorMain, nullptr, stack, stackSize, 16, 0))) {
+        delete thread;
+        free(stack);
+        coordinatorMain(nullptr);
+        return true;
+    }
+    nn::os::StartThread(thread);
+    return true;
+}
+
+void waitLoaded() {
+    if (__atomic_load_n(&loadState, __ATOMIC_ACQUIRE) == LoadState_Loading) nn::os::WaitEvent(&loadedEvent);
+}
+
+bool tryLoad() {
+    if (!startLoad()) return false;
+    waitLoaded();
+    return nameToAddr.size() > 0 || mapSymbolCount > 0;
+}
+
+uintptr_t getSymbolAddress(std::string_view name) {
+    waitLoaded();
+
+    u64 hash = hashName(name);
+    u64& miss = missCache[hash % MISS_CACHE_SIZE];
+    // 0 marks an empty slot
+    if (hash != 0 && __atomic_load_n(&miss, __ATOMIC_RELAXED) == hash) return 0;
+
+    for (auto& map : maps) {
+        uintptr_t address = lookupIndexedMap(map, name, hash);
+        if (address != 0) return address;
+    }
+
+    auto it = nameToAddr.find(name);
+    if (it != nameToAddr.end()) return it->second;
+
+    __atomic_store_n(&miss, hash, __ATOMIC_RELAXED);
+    return 0;
+}
+
+uintptr_t getSymbolAddress(const char* name) { return getSymbolAddress(std::string_view(name)); }
+
+// the block holding address, if size bytes from it can be read
+static bool isReadable(uintptr_t address, size_t size) {
+    MemoryInfo info;
+    u32 pageInfo;
+    if (R_FAILED(svcQueryMemory(&info, &pageInfo, address)) || (info.perm & Perm_R) == 0) return false;
+    return size <= info.addr + info.size - address;
+}
+
+struct Mod0Header {
+    u32 magic;
+    s32 dynamicOffset;  // the rest is relative to the header as well
+    s32 bssStart;
+    s32 bssEnd;
+    s32 ehFrameHdrStart;
+    s32 ehFrameHdrEnd;
+    s32 moduleObject;
+};
+
+// reads the exported functions of the NSO or NRO whose .text starts at base, through its MOD0 header and dynamic
+// section. both are only trusted as far as they can be read
+static bool indexDynsym(uintptr_t base, uintptr_t textEnd, ReverseIndex* out) {
+    uintptr_t mod0 = base + reinterpret_cast<const u32*>(base)[1];
+    if (!isReadable(mod0, sizeof(Mod0Header))) return false;
+    auto header = reinterpret_cast<const Mod0Header*>(mod0);
+    if (header->magic != 0x30444f4d) return false;  // "MOD0"
+
+    const Elf64_Sym* symtab = nullptr;
+    const char* strtab = nullptr;
+    const u32* hash = nullptr;
+    size_t strsz = 0;
+    for (auto dyn = reinterpret_cast<const Elf64_Dyn*>(mod0 + header->dynamicOffset);
+         isReadable(reinterpret_cast<uintptr_t>(dyn), sizeof(Elf64_Dyn)) && dyn->d_tag != DT_NULL; dyn++) {
+        switch (dyn->d_tag) {
+            case DT_SYMTAB:
+                symtab = reinterpret_cast<const Elf64_Sym*>(base + dyn->d_un.d_ptr);
+                break;
+            case DT_STRTAB:
+                strtab = reinterpret_cast<const char*>(base + dyn->d_un.d_ptr);
+                break;
+            case DT_STRSZ:
+                strsz = dyn->d_un.d_val;
+                break;
+            case DT_HASH:
+                hash = reinterpret_cast<const u32*>(base + dyn->d_un.d_ptr);
+                break;
         }
-        fileBuffer[entry.fileSize] = 0; // Null-terminate
+    }
+
+    // the chain of the SysV hash table has one entry per symbol
+    if (symtab == nullptr || strtab == nullptr || hash == nullptr || strsz == 0 ||
+        !isReadable(reinterpret_cast<uintptr_t>(hash), 2 * sizeof(u32)) ||
+        !isReadable(reinterpret_cast<uintptr_t>(symtab), hash[1] * sizeof(Elf64_Sym)) ||
+        !isReadable(reinterpret_cast<uintptr_t>(strtab), strsz) || strtab[strsz - 1] != 0)
+        return false;
+
+    out->base = base;
+    out->end = textEnd;
+    out->strings = strtab;
+    out->entries.clear();
+    for (u32 i = 0; i < hash[1]; i++) {
+        const Elf64_Sym& sym = symtab[i];
+        if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_shndx == SHN_UNDEF || sym.st_name >= strsz ||
+            sym.st_value == 0 || sym.st_value >= textEnd - base)
+            continue;
+        out->entries.push_back({static_cast<u32>(sym.st_value), sym.st_name});
+        if (sym.st_size != 0) out->entries.push_back({static_cast<u32>(sym.st_value + sym.st_size), NO_SYMBOL});
+    }
+    // a symbol starting where another one ends goes after its end marker
+    std::sort(out->entries.begin(), out->entries.end(), [](const ReverseEntry& a, const ReverseEntry& b) {
+        return a.offset < b.offset || (a.offset == b.offset && a.name == NO_SYMBOL && b.name != NO_SYMBOL);
+    });
+    return true;
+}
 
-        nn::fs::CloseFile(handle);
+void indexModules() {
+    std::vector<ReverseIndex> indices;
 
-        parse(fileBuffer);
+    // NSOs are mapped as CodeStatic, NROs loaded through nn::ro as ModuleCodeStatic
+    MemoryInfo info;
+    u32 pageInfo;
+    for (u64 addr = 0; R_SUCCEEDED(svcQueryMemory(&info, &pageInfo, addr));) {
+        u32 type = info.type & 0xff;
+        if ((type == MemType_CodeStatic || type == MemType_ModuleCodeStatic) && (info.perm & Perm_Rx) == Perm_Rx) {
+            ReverseIndex index;
+            if (indexDynsym(info.addr, info.addr + info.size, &index)) indices.push_back(std::move(index));
+        }
 
-        delete[] fileBuffer;
+        // wraps around past the end of the address space
+        if (info.addr + info.size <= addr) break;
+        addr = info.addr + info.size;
     }
 
-    nn::fs::CloseDirectory(dirHandle);
-    delete[] entryBuffer;
+    lockReverse();
+    moduleIndices = std::move(indices);
+    unlockReverse();
+}
+
+static void findInIndices(const std::vector<ReverseIndex>& indices, uintptr_t address, uintptr_t* best,
+                          const char** name) {
+    for (auto& index : indices) {
+        if (address < index.base || address >= index.end) continue;
+
+        auto it = std::upper_bound(index.entries.begin(), index.entries.end(), address - index.base,
+                                   [](uintptr_t offset, const ReverseEntry& entry) { return offset < entry.offset; });
+        if (it == index.entries.begin()) continue;
 
-    if (nameToAddr.size() == 0) {
-        logger->LogFormat("[SymbolMap] The symbol map was parsed without errors, but no symbols were added.");
+        --it;
+        if (it->name == NO_SYMBOL) continue;
+        if (index.base + it->offset >= *best || *name == nullptr) {
+            *best = index.base + it->offset;
+            *name = index.strings + it->name;
+        }
     }
+}
+
+void dropModule(uintptr_t base) {
+    lockReverse();
+    moduleIndices.erase(std::remove_if(moduleIndices.begin(), moduleIndices.end(),
+                                       [base](const ReverseIndex& index) { return index.base == base; }),
+                        moduleIndices.end());
+    unlockReverse();
+}
+
+// called with reverseMutex held
+static bool findSymbol(uintptr_t address, const char** name, uintptr_t* offset) {
+    uintptr_t best = 0;
+    const char* found = nullptr;
+    findInIndices(mapIndices, address, &best, &found);
+    findInIndices(moduleIndices, address, &best, &found);
+
+    if (found == nullptr) return false;
+    *name = found;
+    *offset = address - best;
+    return true;
+}
+
+bool symbolize(uintptr_t address, const char** name, uintptr_t* offset) {
+    lockReverse();
+    bool found = findSymbol(address, name, offset);
+    unlockReverse();
+    return found;
+}
+
+bool trySymbolize(uintptr_t address, const char** name, uintptr_t* offset) {
+    if (!__atomic_load_n(&reverseReady, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&reverseOwner, __ATOMIC_RELAXED) == nn::os::GetCurrentThread() ||
+        !nn::os::TryLockMutex(&reverseMutex))
+        return false;
 
-    return nameToAddr.size() > 0;
+    __atomic_store_n(&reverseOwner, nn::os::GetCurrentThread(), __ATOMIC_RELAXED);
+    bool found = findSymbol(address, name, offset);
+    unlockReverse();
+    return found;
 }
 
-uintptr_t getSymbolAddress(std::string name) {
-    return nameToAddr[name];
+bool symbolize(uintptr_t address, std::string* name, uintptr_t* offset) {
+    const char* found;
+    if (!symbolize(address, &found, offset)) return false;
+    *name = found;
+    return true;
 }
 
 }  // namespace skyline::utils::SymbolMap
@@ -31,6 +31,102 @@
     str x0, [sp, #0x0]
 .endm
 
+.macro armBackupCallerSavedRegisters
+    sub sp, sp, #0x100
+    str x30, [sp, #0xF0]
+    stp x17, x18, [sp, #0x88]
+    stp x15, x16, [sp, #0x78]
+    stp x13, x14, [sp, #0x68]
+    stp x11, x12, [sp, #0x58]
+    stp x9, x10, [sp, #0x48]
+    stp x7, x8, [sp, #0x38]
+    stp x5, x6, [sp, #0x28]
+    stp x3, x4, [sp, #0x18]
+    stp x1, x2, [sp, #0x8]
+    str x0, [sp, #0x0]
+.endm
+
+// condition flags go in the unused slot at the top of the frame, so hooks placed between a compare and its branch
+// don't see them clobbered by the callback
+.macro armBackupFlags
+    mrs x16, nzcv
+    str x16, [sp, #0xF8]
+.endm
+
+.macro armBackupFpRegisters
+    stp q0, q1, [sp, #0x100]
+    stp q2, q3, [sp, #0x120]
+    stp q4, q5, [sp, #0x140]
+    stp q6, q7, [sp, #0x160]
+    stp q8, q9, [sp, #0x180]
+    stp q10, q11, [sp, #0x1A0]
+    stp q12, q13, [sp, #0x1C0]
+    stp q14, q15, [sp, #0x1E0]
+    stp q16, q17, [sp, #0x200]
+    stp q18, q19, [sp, #0x220]
+    stp q20, q21, [sp, #0x240]
+    stp q22, q23, [sp, #0x260]
+    stp q24, q25, [sp, #0x280]
+    stp q26, q27, [sp, #0x2A0]
+    stp q28, q29, [sp, #0x2C0]
+    stp q30, q31, [sp, #0x2E0]
+.endm
+
+.macro armRecoverFpRegisters
+    ldp q0, q1, [sp, #0x100]
+    ldp q2, q3, [sp, #0x120]
+    ldp q4, q5, [sp, #0x140]
+    ldp q6, q7, [sp, #0x160]
+    ldp q8, q9, [sp, #0x180]
+    ldp q10, q11, [sp, #0x1A0]
+    ldp q12, q13, [sp, #0x1C0]
+    ldp q14, q15, [sp, #0x1E0]
+    ldp q16, q17, [sp, #0x200]
+    ldp q18, q19, [sp, #0x220]
+    ldp q20, q21, [sp, #0x240]
+    ldp q22, q23, [sp, #0x260]
+    ldp q24, q25, [sp, #0x280]
+    ldp q26, q27, [sp, #0x2A0]
+    ldp q28, q29, [sp, #0x2C0]
+    ldp q30, q31, [sp, #0x2E0]
+.endm
+
+// q0-q7 and q16-q31, the FP/SIMD registers a callback may clobber, in a save area right above the context
+.macro armBackupCallerSavedFpRegisters
+    stp q0, q1, [sp, #0x100]
+    stp q2, q3, [sp, #0x120]
+    stp q4, q5, [sp, #0x140]
+    stp q6, q7, [sp, #0x160]
+    stp q16, q17, [sp, #0x180]
+    stp q18, q19, [sp, #0x1A0]
+    stp q20, q21, [sp, #0x1C0]
+    stp q22, q23, [sp, #0x1E0]
+    stp q24, q25, [sp, #0x200]
+    stp q26, q27, [sp, #0x220]
+    stp q28, q29, [sp, #0x240]
+    stp q30, q31, [sp, #0x260]
+.endm
+
+.macro armRecoverCallerSavedFpRegisters
+    ldp q0, q1, [sp, #0x100]
+    ldp q2, q3, [sp, #0x120]
+    ldp q4, q5, [sp, #0x140]
+    ldp q6, q7, [sp, #0x160]
+    ldp q16, q17, [sp, #0x180]
+    ldp q18, q19, [sp, #0x1A0]
+    ldp q20, q21, [sp, #0x1C0]
+    ldp q22, q23, [sp, #0x1E0]
+    ldp q24, q25, [sp, #0x200]
+    ldp q26, q27, [sp, #0x220]
+    ldp q28, q29, [sp, #0x240]
+    ldp q30, q31, [sp, #0x260]
+.endm
+
+.macro armRecoverFlags
+    ldr x16, [sp, #0xF8]
+    msr nzcv, x16
+.endm
+
 .macro armRecoverRegisters
     ldr x0, [sp, #0x0]
     ldp x1, x2, [sp, #0x8]
@@ -51,19 +147,144 @@
     add sp, sp, #0x100
 .endm
 
+.macro armRecoverCallerSavedRegisters
+    ldr x0, [sp, #0x0]
+    ldp x1, x2, [sp, #0x8]
+    ldp x3, x4, [sp, #0x18]
+    ldp x5, x6, [sp, #0x28]
+    ldp x7, x8, [sp, #0x38]
+    ldp x9, x10, [sp, #0x48]
+    ldp x11, x12, [sp, #0x58]
+    ldp x13, x14, [sp, #0x68]
+    ldp x15, x16, [sp, #0x78]
+    ldp x17, x18, [sp, #0x88]
+    ldr x30, [sp, #0xF0]
+    add sp, sp, #0x100
+.endm
+
 
 CODE_BEGIN inlineHandlerImpl
+    sub sp, sp, #0x180
+    armBackupRegisters
+    armBackupFlags
+    armBackupCallerSavedFpRegisters
+
+    // branch and link to hook callback
+    mov x0, sp
+    ldr x16, [x17, #8]
+    blr x16
+
+    armRecoverCallerSavedFpRegisters
+    armRecoverFlags
+    armRecoverRegisters
+    add sp, sp, #0x180
+
+    // branch to trampoline, through the slot updated when hooks are chained
+    ldr x16, [x17, #0x10]
+    ldr x16, [x16]
+    br x16
+
+CODE_END
+
+// only saves what the callback may clobber, x19-x28 and q8-q15 are left to the callee and not valid in the context
+CODE_BEGIN inlineHandlerMinimalImpl
+    sub sp, sp, #0x180
+    armBackupCallerSavedRegisters
+    armBackupFlags
+    armBackupCallerSavedFpRegisters
+
+    // branch and link to hook callback
+    mov x0, sp
+    ldr x16, [x17, #8]
+    blr x16
+
+    armRecoverCallerSavedFpRegisters
+    armRecoverFlags
+    armRecoverCallerSavedRegisters
+    add sp, sp, #0x180
+
+    // branch to trampoline, through the slot updated when hooks are chained
+    ldr x16, [x17, #0x10]
+    ldr x16, [x16]
+    br x16
+
+CODE_END
+
+// full context followed by q0-q31
+CODE_BEGIN inlineHandlerFpImpl
+    sub sp, sp, #0x200
     armBackupRegisters
+    armBackupFlags
+    armBackupFpRegisters
 
     // branch and link to hook callback
     mov x0, sp
     ldr x16, [x17, #8]
     blr x16
 
+    armRecoverFpRegisters
+    armRecoverFlags
     armRecoverRegisters
+    add sp, sp, #0x200
 
-    // branch to trampoline
+    // branch to trampoline, through the slot updated when hooks are chained
     ldr x16, [x17, #0x10]
+    ldr x16, [x16]
+    br x16
+
+CODE_END
+
+
+// saves everything a call may use to pass arguments or return values, for probes placed around a function
+.macro armBackupArgumentRegisters
+    sub sp, sp, #0xD0
+    stp x0, x1, [sp, #0x0]
+    stp x2, x3, [sp, #0x10]
+    stp x4, x5, [sp, #0x20]
+    stp x6, x7, [sp, #0x30]
+    stp x8, x30, [sp, #0x40]
+    stp q0, q1, [sp, #0x50]
+    stp q2, q3, [sp, #0x70]
+    stp q4, q5, [sp, #0x90]
+    stp q6, q7, [sp, #0xB0]
+.endm
+
+.macro armRecoverArgumentRegisters
+    ldp x0, x1, [sp, #0x0]
+    ldp x2, x3, [sp, #0x10]
+    ldp x4, x5, [sp, #0x20]
+    ldp x6, x7, [sp, #0x30]
+    ldp x8, x30, [sp, #0x40]
+    ldp q0, q1, [sp, #0x50]
+    ldp q2, q3, [sp, #0x70]
+    ldp q4, q5, [sp, #0x90]
+    ldp q6, q7, [sp, #0xB0]
+    add sp, sp, #0xD0
+.endm
+
+// called by an A64TimeHook entry probe with x16 pointing at its block, returns where the function should return to in
+// x17. the caller's lr was pushed by the probe right above our frame
+CODE_BEGIN timeProbeEnter
+    armBackupArgumentRegisters
+
+    mov x0, x16
+    ldr x1, [sp, #0xD8]
+    bl skyline_time_probe_enter
+    mov x17, x0
+
+    armRecoverArgumentRegisters
+    ret
+
+CODE_END
+
+// reached when a timed function returns, continues to its caller
+CODE_BEGIN timeProbeExit
+    armBackupArgumentRegisters
+
+    bl skyline_time_probe_exit
+    mov x16, x0
+
+    armRecoverArgumentRegisters
     br x16
 
 CODE_END
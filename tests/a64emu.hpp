@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Interprets the subset of AArch64 the relocator test cases and the relocator's own output consist of, so the
+// differential test also runs on hosts that can't execute the code. Memory is the host's, restricted to the regions
+// that were added. Anything outside the subset stops the run as a failure
+class A64Emu {
+   public:
+    uint64_t x[32] = {};  // x31 reads as zero, no instruction in the subset addresses sp
+    uint64_t d[32] = {};
+    uint64_t nzcv = 0;
+    uint64_t pc = 0;
+
+    void addRegion(uintptr_t start, size_t size) { m_Regions.push_back({start, size}); }
+
+    // runs from pc until it reaches stop, returning false on an unsupported instruction, a stray access, or after
+    // too many steps
+    bool run(uint64_t stop, size_t max_steps = 1000) {
+        for (size_t i = 0; i < max_steps; i++) {
+            if (pc == stop) return true;
+            uint32_t ins;
+            if (!load(pc, &ins, sizeof(ins))) return false;
+            if (!step(ins)) {
+                fprintf(stderr, "  unsupported instruction %08x at %#llx\n", ins, static_cast<unsigned long long>(pc));
+                return false;
+            }
+        }
+        fprintf(stderr, "  no exit after %zu steps\n", max_steps);
+        return false;
+    }
+
+   private:
+    struct Region {
+        uintptr_t start;
+        size_t size;
+    };
+    std::vector<Region> m_Regions;
+
+    bool mapped(uint64_t address, size_t size) {
+        for (auto& r : m_Regions) {
+            if (address >= r.start && address + size <= r.start + r.size) return true;
+        }
+        fprintf(stderr, "  stray access to %#llx\n", static_cast<unsigned long long>(address));
+        return false;
+    }
+    bool load(uint64_t address, void* out, size_t size) {
+        if (!mapped(address, size)) return false;
+        memcpy(out, reinterpret_cast<void*>(address), size);
+        return true;
+    }
+    bool store(uint64_t address, const void* in, size_t size) {
+        if (!mapped(address, size)) return false;
+        memcpy(reinterpret_cast<void*>(address), in, size);
+        return true;
+    }
+
+    uint64_t reg(uint32_t n) { return n == 31 ? 0 : x[n]; }
+    void setReg(uint32_t n, uint64_t value) {
+        if (n != 31) x[n] = value;
+    }
+
+    static int64_t signExtend(uint64_t value, int bits) {
+        return static_cast<int64_t>(value << (64 - bits)) >> (64 - bits);
+    }
+
+    bool condition(uint32_t cond) {
+        bool n = nzcv >> 31 & 1, z = nzcv >> 30 & 1, c = nzcv >> 29 & 1, v = nzcv >> 28 & 1;
+        bool result;
+        switch (cond >> 1) {
+            case 0: result = z; break;
+            case 1: result = c; break;
+            case 2: result = n; break;
+            case 3: result = v; break;
+            case 4: result = c && !z; break;
+            case 5: result = n == v; break;
+            case 6: result = n == v && !z; break;
+            default: result = true; break;
+        }
+        return (cond & 1) && cond != 15 ? !result : result;
+    }
+
+    bool step(uint32_t ins) {
+        uint32_t rd = ins & 31, rn = (ins >> 5) & 31;
+        uint64_t next = pc + 4;
+
+        if (ins == 0xd503201fu) {  // NOP
+        } else if ((ins & 0xff800000u) == 0xd2800000u) {  // MOVZ Xd, #imm16, LSL #hw
+            setReg(rd, static_cast<uint64_t>((ins >> 5) & 0xffff) << (((ins >> 21) & 3) * 16));
+        } else if ((ins & 0xffc00000u) == 0x91000000u) {  // ADD Xd, Xn, #imm12
+            uint64_t value = (rn == 31 ? 0 : x[rn]) + ((ins >> 10) & 0xfff);
+            setReg(rd, value);
+        } else if ((ins & 0xffc00000u) == 0xf1000000u) {  // SUBS Xd, Xn, #imm12
+            uint64_t a = reg(rn), b = (ins >> 10) & 0xfff, result = a - b;
+            bool n = result >> 63, z = result == 0, c = a >= b;
+            bool v = ((a ^ b) & (a ^ result)) >> 63;
+            nzcv = (uint64_t(n) << 31) | (uint64_t(z) << 30) | (uint64_t(c) << 29) | (uint64_t(v) << 28);
+            setReg(rd, result);
+        } else if ((ins & 0x7c000000u) == 0x14000000u) {  // B/BL
+            if (ins >> 31) x[30] = pc + 4;
+            next = pc + signExtend(ins & 0x3ffffff, 26) * 4;
+        } else if ((ins & 0xff000010u) == 0x54000000u) {  // B.cond
+            if (condition(ins & 15)) next = pc + signExtend((ins >> 5) & 0x7ffff, 19) * 4;
+        } else if ((ins & 0x7e000000u) == 0x34000000u) {  // CBZ/CBNZ
+            uint64_t value = ins >> 31 ? reg(rd) : static_cast<uint32_t>(reg(rd));
+            if ((value == 0) != ((ins >> 24) & 1)) next = pc + signExtend((ins >> 5) & 0x7ffff, 19) * 4;
+        } else if ((ins & 0x7e000000u) == 0x36000000u) {  // TBZ/TBNZ
+            uint32_t bit = ((ins >> 31) << 5) | ((ins >> 19) & 31);
+            if (((reg(rd) >> bit) & 1) == ((ins >> 24) & 1)) next = pc + signExtend((ins >> 5) & 0x3fff, 14) * 4;
+        } else if ((ins & 0x1f000000u) == 0x10000000u) {  // ADR/ADRP
+            int64_t imm = signExtend((((ins >> 5) & 0x7ffff) << 2) | ((ins >> 29) & 3), 21);
+            setReg(rd, ins >> 31 ? (pc & ~0xfffull) + (imm << 12) : pc + imm);
+        } else if ((ins & 0x3b000000u) == 0x18000000u) {  // LDR (literal)
+            uint64_t address = pc + signExtend((ins >> 5) & 0x7ffff, 19) * 4;
+            uint32_t opc = ins >> 30;
+            if (ins & 0x04000000u) {  // SIMD&FP, only S and D are in the subset
+                if (opc > 1) return false;
+                d[rd] = 0;
+                if (!load(address, &d[rd], opc == 0 ? 4 : 8)) return false;
+            } else if (opc == 0) {
+                uint32_t value;
+                if (!load(address, &value, 4)) return false;
+                setReg(rd, value);
+            } else if (opc == 1) {
+                uint64_t value;
+                if (!load(address, &value, 8)) return false;
+                setReg(rd, value);
+            } else if (opc == 2) {
+                int32_t value;
+                if (!load(address, &value, 4)) return false;
+                setReg(rd, static_cast<int64_t>(value));
+            } else {  // PRFM
+            }
+        } else if ((ins & 0xffc00000u) == 0xf9000000u) {  // STR Xt, [Xn, #imm]
+            if (!store(reg(rn) + ((ins >> 10) & 0xfff) * 8, &x[rd], 8)) return false;
+        } else if ((ins & 0xfffffc00u) == 0x9e660000u) {  // FMOV Xd, Dn
+            setReg(rd, d[rn]);
+        } else if ((ins & 0xfffffc1fu) == 0xd61f0000u) {  // BR
+            next = reg(rn);
+        } else if ((ins & 0xfffffc1fu) == 0xd65f0000u) {  // RET
+            next = reg(rn);
+        } else {
+            return false;
+        }
+
+        pc = next;
+        return true;
+    }
+};
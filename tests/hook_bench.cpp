@@ -0,0 +1,18 @@
+// Per-call overhead of each hook mechanism, through A64HookBenchmark as it runs on console. Its hooks patch the
+// program's own code, so this only builds for AArch64, and runs natively or under qemu-aarch64
+#include <cstdio>
+#include <cstdlib>
+
+#include "skyline/inlinehook/And64InlineHook.hpp"
+
+int main(int argc, char** argv) {
+    A64HookInit();
+
+    u32 iterations = argc > 1 ? strtoul(argv[1], nullptr, 0) : 1000000;
+    Result rc = A64HookBenchmark(iterations);
+    if (R_FAILED(rc)) {
+        fprintf(stderr, "A64HookBenchmark(%u) failed with 0x%x\n", iterations, rc);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Compile test of skyline::hook::Hook on the host. Built as is, every supported kind of target has to compile, with
+// the types the wrapper is expected to give them. Built with -DNEGATIVE=n, case n has to fail to compile, with the
+// diagnostic given on its "negative n:" line below. Nothing is run, the hook API is only declared
+#include <type_traits>
+
+#include "skyline/hook/Hook.hpp"
+
+using skyline::hook::Hook;
+
+int plain(int value, const char* name);
+int plainReplace(int value, const char* name);
+int plainNoexceptReplace(int value, const char* name) noexcept;
+
+void nothrow(long value) noexcept;
+void nothrowReplace(long value) noexcept;
+void nothrowThrowingReplace(long value);
+
+int format(const char* format, ...);
+int formatReplace(const char* format, ...);
+
+int formatNothrow(char* out, const char* format, ...) noexcept;
+int formatNothrowReplace(char* out, const char* format, ...);
+
+extern "C" unsigned long cFunction(void* data);
+extern "C" unsigned long cFunctionReplace(void* data);
+
+int overloaded(int value);
+int overloaded(float value);
+int overloadedReplace(float value);
+
+struct Object {
+    int member(int value);
+    static int staticMember(int value);
+};
+int staticMemberReplace(int value);
+
+static int s_Value;
+
+//-------------------------------------------------------------------------
+
+// the original is called through the target's exact type
+static_assert(std::is_same_v<Hook<&plain>::Function, int (*)(int, const char*)>);
+static_assert(std::is_same_v<Hook<&nothrow>::Function, void (*)(long) noexcept>);
+static_assert(std::is_same_v<Hook<&format>::Function, int (*)(const char*, ...)>);
+static_assert(std::is_same_v<Hook<&formatNothrow>::Function, int (*)(char*, const char*, ...) noexcept>);
+static_assert(std::is_same_v<Hook<&cFunction>::Function, unsigned long (*)(void*)>);
+// without & as well, the function decays
+static_assert(std::is_same_v<Hook<plain>::Function, Hook<&plain>::Function>);
+
+// original returns what the target does, and keeps its noexcept
+static_assert(std::is_same_v<decltype(Hook<&plain>::original(1, "")), int>);
+static_assert(std::is_same_v<decltype(Hook<&nothrow>::original(1)), void>);
+static_assert(std::is_same_v<decltype(Hook<&format>::original("%d %s", 1, "")), int>);
+static_assert(noexcept(Hook<&nothrow>::original(1)));
+static_assert(noexcept(Hook<&formatNothrow>::original(nullptr, "%f", 1.0)));
+static_assert(!noexcept(Hook<&plain>::original(1, "")));
+static_assert(!noexcept(Hook<&format>::original("")));
+
+// every kind of target installs, and makes batch entries, with a matching replacement
+void installs() {
+    Hook<&plain>::install(plainReplace);
+    Hook<&plain>::install(&plainNoexceptReplace);
+    Hook<&nothrow>::install(nothrowReplace);
+    Hook<&nothrow>::install(nothrowThrowingReplace, 1);
+    Hook<&format>::install(formatReplace);
+    Hook<&formatNothrow>::install(formatNothrowReplace);
+    Hook<&cFunction>::install(cFunctionReplace);
+    Hook<static_cast<int (*)(float)>(overloaded)>::install(overloadedReplace);
+    Hook<&Object::staticMember>::install(staticMemberReplace);
+    Hook<&plain>::install([](int value, const char*) { return value; });
+
+    const HookSpec specs[] = {
+        Hook<&plain>::spec(plainReplace),
+        Hook<&nothrow>::spec(nothrowThrowingReplace),
+        Hook<&format>::spec(formatReplace, 2),
+        Hook<&formatNothrow>::spec(formatNothrowReplace),
+    };
+    A64HookFunctionBatch(specs, sizeof(specs) / sizeof(specs[0]));
+
+    Hook<&plain>::remove();
+    static_cast<void>(Hook<&plain>::installed() && Hook<&plain>::handle() != 0);
+}
+
+//-------------------------------------------------------------------------
+
+#if NEGATIVE == 1
+// negative 1: replacement does not match the hooked function
+void negative() { Hook<&plain>::install(formatReplace); }
+#elif NEGATIVE == 2
+// negative 2: replacement does not match the hooked function
+long wrongReturn(int value, const char* name);
+void negative() { Hook<&plain>::install(wrongReturn); }
+#elif NEGATIVE == 3
+// negative 3: replacement does not match the hooked function
+void negative() { Hook<&format>::install(plainReplace); }
+#elif NEGATIVE == 4
+// negative 4: replacement does not match the hooked function
+int notVariadic(const char* format);
+void negative() { Hook<&format>::install(notVariadic); }
+#elif NEGATIVE == 5
+// negative 5: replacement does not match the hooked function
+void negative() { Hook<&formatNothrow>::spec(formatReplace); }
+#elif NEGATIVE == 6
+// negative 6: Hook target must be a pointer to a non-member function
+void negative() { Hook<&Object::member>::install(plainReplace); }
+#elif NEGATIVE == 7
+// negative 7: Hook target must be a pointer to a non-member function
+void negative() { Hook<&s_Value>::install(plainReplace); }
+#elif NEGATIVE == 8
+// negative 8: replacement does not match the hooked function
+void negative() { Hook<&plain>::install([](int value, const char*, int) { return value; }); }
+#endif
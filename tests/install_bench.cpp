@@ -0,0 +1,23 @@
+// Install time per hook at growing hook counts, on the host. A64HookInstallBenchmark runs as it does on console, on
+// top of the Linux stand-ins for Jit, ControlledPages and nn::os in standin/
+#include <cstdio>
+#include <cstdlib>
+
+#include "skyline/inlinehook/And64InlineHook.hpp"
+
+int main(int argc, char** argv) {
+    A64HookInit();
+
+    static const u32 s_Counts[] = {10, 100, 1000, 10000};
+    int failures = 0;
+    for (u32 count : s_Counts) {
+        if (argc > 1 && count > strtoul(argv[1], nullptr, 0)) break;
+
+        Result rc = A64HookInstallBenchmark(count);
+        if (R_FAILED(rc)) {
+            fprintf(stderr, "A64HookInstallBenchmark(%u) failed with 0x%x\n", count, rc);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
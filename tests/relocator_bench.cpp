@@ -0,0 +1,69 @@
+// Relocation throughput per case and destination, on the host. Destinations are never written or executed, only the
+// original area has to be readable, for LDR-literal values copied into far relocations
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "relocator_cases.hpp"
+#include "skyline/inlinehook/relocator.hpp"
+
+using skyline::inlinehook::relocateInstructions;
+
+struct Destination {
+    const char* name;
+    intptr_t offset;  // from the area
+};
+
+static const Destination s_Destinations[] = {
+    {"near", 0x4000},
+    {"mid", 0x400000},
+    {"far", 0x200000000ll},
+};
+
+// keeps the relocations from being optimised out
+static volatile uintptr_t s_Sink;
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 0) : 200000;
+    if (iterations == 0) iterations = 1;
+
+    // aligned like a page of code, so ADRP cases see the same page offsets as in the test
+    auto area = static_cast<uint8_t*>(aligned_alloc(0x1000, cases::AREA_SIZE));
+
+    printf("%-20s", "case");
+    for (auto& destination : s_Destinations) printf(" %10s", destination.name);
+    printf("   (ns per relocation, %zu iterations)\n", iterations);
+
+    double total_ns = 0;
+    size_t total_relocations = 0;
+    for (auto& c : cases::all()) {
+        int count = cases::layout(area, c, 0);
+        auto window = reinterpret_cast<uint32_t*>(area + c.window);
+        uint32_t inrw[A64_MAX_INSTRUCTIONS];
+        memcpy(inrw, window, count * sizeof(uint32_t));
+
+        printf("%-20s", c.name);
+        for (auto& destination : s_Destinations) {
+            auto rx = reinterpret_cast<uint32_t*>(reinterpret_cast<uintptr_t>(area) + destination.offset);
+            uint32_t out[A64_MAX_INSTRUCTIONS * 10 + 4];
+
+            auto start = std::chrono::steady_clock::now();
+            uintptr_t written = 0;
+            for (size_t i = 0; i < iterations; i++) written += relocateInstructions(inrw, window, count, out, rx);
+            auto end = std::chrono::steady_clock::now();
+            s_Sink = written;
+
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            total_ns += ns;
+            total_relocations += iterations;
+            printf(" %10.1f", ns / iterations);
+        }
+        printf("\n");
+    }
+
+    printf("average %.1f ns per relocation\n", total_ns / total_relocations);
+    free(area);
+    return 0;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Prologues shared by the relocator test and benchmark. Each case is laid out in a code area of AREA_SIZE bytes:
+// landing pads before and after the window, a literal pool, and the window itself, which ends in an exit stub.
+// Relocated copies branch back to that stub, so both runs leave through the same code
+namespace cases {
+
+constexpr size_t AREA_SIZE = 0x2000;
+constexpr size_t PADS_BEFORE = 0x40;   // B/B.cond/CBZ/TBZ targets behind the window
+constexpr size_t BL_PAD = 0xe0;        // BL target, counts its calls in x10 and returns
+constexpr size_t LITERALS = 0x100;     // literal pool
+constexpr size_t WINDOW = 0x200;       // where most windows start
+constexpr size_t PAGE_WINDOW = 0x1000; // a page aligned window, ADRP of its own page
+constexpr size_t PADS_AFTER = 0x1800;  // targets ahead of the window
+constexpr size_t PAD_STRIDE = 0x20;
+
+constexpr uint32_t NOP = 0xd503201fu;
+
+// literal pool contents
+constexpr uint64_t LIT64 = 0x0123456789abcdefull;
+constexpr uint32_t LIT32 = 0x89abcdefu;  // negative once sign extended
+constexpr double LITD = 1.5;
+
+inline int64_t offset(size_t from, size_t to) { return static_cast<int64_t>(to) - static_cast<int64_t>(from); }
+
+inline uint32_t b(size_t pc, size_t to) { return 0x14000000u | ((offset(pc, to) >> 2) & 0x3ffffff); }
+inline uint32_t bl(size_t pc, size_t to) { return 0x94000000u | ((offset(pc, to) >> 2) & 0x3ffffff); }
+inline uint32_t bcond(size_t pc, size_t to, uint32_t cond) {
+    return 0x54000000u | (((offset(pc, to) >> 2) & 0x7ffff) << 5) | cond;
+}
+inline uint32_t cbz(size_t pc, size_t to, uint32_t rt, bool nonzero = false) {
+    return (nonzero ? 0xb5000000u : 0xb4000000u) | (((offset(pc, to) >> 2) & 0x7ffff) << 5) | rt;
+}
+inline uint32_t tbz(size_t pc, size_t to, uint32_t rt, uint32_t bit, bool nonzero = false) {
+    return ((bit >> 5) << 31) | (nonzero ? 0x37000000u : 0x36000000u) | ((bit & 31) << 19) |
+           (((offset(pc, to) >> 2) & 0x3fff) << 5) | rt;
+}
+inline uint32_t adr(size_t pc, size_t to, uint32_t rd) {
+    int64_t imm = offset(pc, to);
+    return 0x10000000u | ((imm & 3) << 29) | (((imm >> 2) & 0x7ffff) << 5) | rd;
+}
+// pc and to are absolute here, the page distance depends on where the area is
+inline uint32_t adrp(uintptr_t pc, uintptr_t to, uint32_t rd) {
+    int64_t imm = (static_cast<int64_t>(to >> 12) - static_cast<int64_t>(pc >> 12));
+    return 0x90000000u | ((imm & 3) << 29) | (((imm >> 2) & 0x7ffff) << 5) | rd;
+}
+inline uint32_t ldrlit(size_t pc, size_t to, uint32_t opc, uint32_t rt) {
+    return opc | (((offset(pc, to) >> 2) & 0x7ffff) << 5) | rt;
+}
+constexpr uint32_t LDR_X = 0x58000000u;
+constexpr uint32_t LDR_W = 0x18000000u;
+constexpr uint32_t LDRSW = 0x98000000u;
+constexpr uint32_t LDR_D = 0x5c000000u;
+
+inline uint32_t movz(uint32_t rd, uint32_t imm) { return 0xd2800000u | (imm << 5) | rd; }
+constexpr uint32_t CMP_X0_0 = 0xf100001fu;       // CMP X0, #0
+constexpr uint32_t ADD_X10_1 = 0x9100054au;      // ADD X10, X10, #1
+constexpr uint32_t ADD_X0_X0_0x10 = 0x91004000u; // ADD X0, X0, #0x10
+constexpr uint32_t RET = 0xd65f03c0u;
+constexpr uint32_t STR_X0_X1 = 0xf9000020u;      // STR X0, [X1]
+constexpr uint32_t STR_X3_X1_8 = 0xf9000423u;    // STR X3, [X1, #8]
+constexpr uint32_t FMOV_X6_D0 = 0x9e660006u;     // FMOV X6, D0
+
+enum Cond : uint32_t { EQ = 0, NE = 1, CS = 2, MI = 4, VS = 6, GE = 10, LT = 11 };
+
+inline size_t padBefore(int k) { return PADS_BEFORE + k * PAD_STRIDE; }
+inline size_t padAfter(int k) { return PADS_AFTER + k * PAD_STRIDE; }
+
+struct Case {
+    const char* name;
+    size_t window;  // offset of the window in the area
+    // writes the window's instructions, given the area's absolute address for ADRP
+    std::vector<uint32_t> (*build)(uintptr_t area, size_t window);
+};
+
+// every case in the suite, covering each class of PC-relative instruction the relocator rewrites
+inline const std::vector<Case>& all() {
+    static const std::vector<Case> s_Cases = {
+        {"adrp", WINDOW,
+         [](uintptr_t area, size_t w) -> std::vector<uint32_t> {
+             return {adrp(area + w, area + LITERALS, 0), ADD_X0_X0_0x10, adrp(area + w + 8, area + 0x10000, 2),
+                     adrp(area + w + 12, area - 0x200000, 3)};
+         }},
+        // the ADRP refers to the page the window starts on, which the relocator must not mistake for the window
+        {"adrp_own_page", PAGE_WINDOW,
+         [](uintptr_t area, size_t w) -> std::vector<uint32_t> {
+             return {adrp(area + w, area + w, 0), movz(4, 1), adrp(area + w + 8, area + w, 5)};
+         }},
+        {"ldr_literal", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {ldrlit(w, LITERALS, LDR_X, 3), ldrlit(w + 4, LITERALS + 8, LDR_W, 4),
+                     ldrlit(w + 8, LITERALS + 8, LDRSW, 5), ldrlit(w + 12, LITERALS + 16, LDR_D, 0), FMOV_X6_D0};
+         }},
+        {"b_bcond", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {CMP_X0_0, bcond(w + 4, padBefore(0), EQ), bcond(w + 8, padAfter(0), LT), movz(11, 7),
+                     b(w + 16, padAfter(1))};
+         }},
+        {"bl", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {bl(w, BL_PAD), movz(12, 3), bl(w + 8, BL_PAD), movz(13, 4)};
+         }},
+        {"cbz_tbz", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {cbz(w, padBefore(1), 0), tbz(w + 4, padAfter(2), 0, 63, true), cbz(w + 8, padBefore(2), 0, true),
+                     tbz(w + 12, padAfter(3), 0, 1)};
+         }},
+        // branches to later instructions of the window itself are fixed up once their target is relocated
+        {"branch_into_window", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {cbz(w, w + 12, 0), tbz(w + 4, w + 16, 0, 0, true), movz(11, 1), movz(12, 2), movz(13, 3)};
+         }},
+        {"bcond_flags", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {bcond(w, padBefore(3), MI), bcond(w + 4, padAfter(4), CS), bcond(w + 8, padBefore(4), VS),
+                     bcond(w + 12, padAfter(5), NE), movz(11, 9)};
+         }},
+        {"adr", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {adr(w, LITERALS + 3, 5), adr(w + 4, padAfter(0), 6), adr(w + 8, 0, 7)};
+         }},
+        {"memory", WINDOW,
+         [](uintptr_t, size_t w) -> std::vector<uint32_t> {
+             return {STR_X0_X1, ldrlit(w + 4, LITERALS, LDR_X, 3), STR_X3_X1_8, adr(w + 12, LITERALS + 8, 2)};
+         }},
+    };
+    return s_Cases;
+}
+
+// writes an LDR X17/BR X17 jump to target at at, aligning the literal. returns the end of the stub
+inline uint32_t* emitJump(uint32_t* at, uint64_t target) {
+    if ((reinterpret_cast<uintptr_t>(at + 2) & 7) != 0) *at++ = NOP;
+    at[0] = 0x58000051u;  // LDR X17, #0x8
+    at[1] = 0xd61f0220u;  // BR X17
+    memcpy(at + 2, &target, sizeof(target));
+    return at + 4;
+}
+
+// fills area with the pads, literals and the case's window, returning the window's instruction count. every exit
+// jumps to exit, pad k setting x9 to k + 1 (k + 0x11 behind the window)
+inline int layout(uint8_t* area, const Case& c, uint64_t exit) {
+    uint32_t* words = reinterpret_cast<uint32_t*>(area);
+    for (size_t i = 0; i < AREA_SIZE / sizeof(uint32_t); i++) words[i] = NOP;
+
+    for (int k = 0; k < 5; k++) {
+        uint32_t* pad = reinterpret_cast<uint32_t*>(area + padBefore(k));
+        pad[0] = movz(9, 0x11 + k);
+        emitJump(pad + 1, exit);
+    }
+    for (int k = 0; k < 6; k++) {
+        uint32_t* pad = reinterpret_cast<uint32_t*>(area + padAfter(k));
+        pad[0] = movz(9, 1 + k);
+        emitJump(pad + 1, exit);
+    }
+    reinterpret_cast<uint32_t*>(area + BL_PAD)[0] = ADD_X10_1;
+    reinterpret_cast<uint32_t*>(area + BL_PAD)[1] = RET;
+
+    memcpy(area + LITERALS, &LIT64, sizeof(LIT64));
+    memcpy(area + LITERALS + 8, &LIT32, sizeof(LIT32));
+    memcpy(area + LITERALS + 16, &LITD, sizeof(LITD));
+
+    std::vector<uint32_t> window = c.build(reinterpret_cast<uintptr_t>(area), c.window);
+    memcpy(area + c.window, window.data(), window.size() * sizeof(uint32_t));
+    emitJump(reinterpret_cast<uint32_t*>(area + c.window) + window.size(), exit);
+    return static_cast<int>(window.size());
+}
+
+};  // namespace cases
@@ -0,0 +1,267 @@
+// Differential test of the relocator: every case is run once from its original address and once relocated to
+// addresses near, within B range (but out of B.cond/LDR-literal range), and beyond B range of it, at both 8-byte
+// alignments. Register state, flags and memory effects have to match. Built for aarch64 (under qemu-aarch64 off
+// device) the code runs natively, on any other host it runs through A64Emu
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "relocator_cases.hpp"
+#include "skyline/inlinehook/relocator.hpp"
+
+#if !defined(__aarch64__)
+#include "a64emu.hpp"
+#endif
+
+using skyline::inlinehook::relocateInstructions;
+
+struct CpuState {
+    uint64_t x[16];
+    uint64_t nzcv;
+    uint64_t entry;
+};
+static_assert(offsetof(CpuState, nzcv) == 128 && offsetof(CpuState, entry) == 136, "the harness hardcodes these");
+
+// x1 points here, for the cases' stores
+static uint64_t s_Memory[4];
+
+static constexpr size_t NEAR_SPAN = 0x800000;  // the area and near/mid destinations share one mapping
+static constexpr size_t MID_OFFSET = 0x400000;
+static constexpr size_t FAR_SIZE = 0x10000;
+
+#if defined(__aarch64__)
+
+extern "C" void run_code(CpuState* state);
+extern "C" char code_exit[];
+
+// loads x0-x15 and nzcv from the state in x0, jumps to its entry, and stores them back once code_exit is reached.
+// x28 holds the state throughout, the cases never touch it
+asm(R"(
+    .text
+    .p2align 2
+    .global run_code
+    .type run_code, %function
+run_code:
+    stp x29, x30, [sp, #-96]!
+    stp x19, x20, [sp, #16]
+    stp x21, x22, [sp, #32]
+    stp x23, x24, [sp, #48]
+    stp x25, x26, [sp, #64]
+    stp x27, x28, [sp, #80]
+    mov x28, x0
+    ldr x9, [x28, #128]
+    msr nzcv, x9
+    ldr x17, [x28, #136]
+    ldp x0, x1, [x28, #0]
+    ldp x2, x3, [x28, #16]
+    ldp x4, x5, [x28, #32]
+    ldp x6, x7, [x28, #48]
+    ldp x8, x9, [x28, #64]
+    ldp x10, x11, [x28, #80]
+    ldp x12, x13, [x28, #96]
+    ldp x14, x15, [x28, #112]
+    br x17
+
+    .global code_exit
+code_exit:
+    stp x0, x1, [x28, #0]
+    stp x2, x3, [x28, #16]
+    stp x4, x5, [x28, #32]
+    stp x6, x7, [x28, #48]
+    stp x8, x9, [x28, #64]
+    stp x10, x11, [x28, #80]
+    stp x12, x13, [x28, #96]
+    stp x14, x15, [x28, #112]
+    mrs x9, nzcv
+    str x9, [x28, #128]
+    ldp x19, x20, [sp, #16]
+    ldp x21, x22, [sp, #32]
+    ldp x23, x24, [sp, #48]
+    ldp x25, x26, [sp, #64]
+    ldp x27, x28, [sp, #80]
+    ldp x29, x30, [sp], #96
+    ret
+)");
+
+static const int PROT_CODE = PROT_READ | PROT_WRITE | PROT_EXEC;
+static uint64_t exitAddress() { return reinterpret_cast<uint64_t>(code_exit); }
+
+static bool run(CpuState* state) {
+    run_code(state);
+    return true;
+}
+
+static void syncCode(void* start, size_t size) {
+    __builtin___clear_cache(static_cast<char*>(start), static_cast<char*>(start) + size);
+}
+
+#else
+
+static const int PROT_CODE = PROT_READ | PROT_WRITE;
+static constexpr uint64_t EXIT = 0xe71700000ull;  // never mapped, reaching it ends the run
+static uint64_t exitAddress() { return EXIT; }
+
+static A64Emu s_Emu;
+
+static bool run(CpuState* state) {
+    for (int i = 0; i < 16; i++) s_Emu.x[i] = state->x[i];
+    for (int i = 16; i < 32; i++) s_Emu.x[i] = 0;
+    s_Emu.nzcv = state->nzcv;
+    s_Emu.pc = state->entry;
+    if (!s_Emu.run(EXIT)) return false;
+    for (int i = 0; i < 16; i++) state->x[i] = s_Emu.x[i];
+    state->nzcv = s_Emu.nzcv;
+    return true;
+}
+
+static void syncCode(void*, size_t) {}
+
+#endif
+
+static void* mapCode(void* hint, size_t size) {
+    void* address = mmap(hint, size, PROT_CODE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+}
+
+struct Placement {
+    const char* name;
+    uint32_t* rx;
+};
+
+static const uint64_t s_X0[] = {0, 1, 2, 0x8000000000000001ull, ~0ull};
+static const uint64_t s_Nzcv[] = {0, 0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u};
+
+static void initialState(CpuState* state, uint64_t x0, uint64_t nzcv, uint64_t entry) {
+    for (int i = 0; i < 16; i++) state->x[i] = 0x5100 + i;
+    state->x[0] = x0;
+    state->x[1] = reinterpret_cast<uint64_t>(s_Memory);
+    state->x[9] = 0;
+    state->x[10] = 0;
+    state->nzcv = nzcv;
+    state->entry = entry;
+}
+
+static bool runFrom(uint64_t entry, uint64_t x0, uint64_t nzcv, CpuState* state, uint64_t memory[2]) {
+    memset(s_Memory, 0, sizeof(s_Memory));
+    initialState(state, x0, nzcv, entry);
+    bool ok = run(state);
+    memory[0] = s_Memory[0];
+    memory[1] = s_Memory[1];
+    return ok;
+}
+
+static void dumpCode(const char* label, const uint32_t* code, size_t count) {
+    fprintf(stderr, "  %s:", label);
+    for (size_t i = 0; i < count; i++) fprintf(stderr, " %08x", code[i]);
+    fprintf(stderr, "\n");
+}
+
+// relocates the case to every placement and compares each against the original, returning the number of failures
+static int runCase(const cases::Case& c, uint8_t* area, const Placement* placements, size_t placementCount) {
+    int count = cases::layout(area, c, exitAddress());
+    uint32_t* window = reinterpret_cast<uint32_t*>(area + c.window);
+    syncCode(area, cases::AREA_SIZE);
+
+    // the relocator reads through a separate rw view, and writes to one as well
+    uint32_t inrw[A64_MAX_INSTRUCTIONS];
+    memcpy(inrw, window, count * sizeof(uint32_t));
+
+    int failures = 0;
+    for (size_t p = 0; p < placementCount; p++) {
+        const Placement& placement = placements[p];
+        uint32_t outrw[A64_MAX_INSTRUCTIONS * 10 + 4] = {};
+        uintptr_t size = relocateInstructions(inrw, window, count, outrw, placement.rx);
+        if (size == 0 || size > sizeof(outrw)) {
+            fprintf(stderr, "FAIL %s/%s: relocated to %zu bytes\n", c.name, placement.name, size_t(size));
+            failures++;
+            continue;
+        }
+        memcpy(placement.rx, outrw, size);
+        syncCode(placement.rx, size);
+
+        bool reported = false;
+        for (uint64_t x0 : s_X0) {
+            for (uint64_t nzcv : s_Nzcv) {
+                CpuState expected, actual;
+                uint64_t expectedMemory[2], actualMemory[2];
+                bool ranOriginal = runFrom(reinterpret_cast<uint64_t>(window), x0, nzcv, &expected, expectedMemory);
+                bool ranRelocated =
+                    runFrom(reinterpret_cast<uint64_t>(placement.rx), x0, nzcv, &actual, actualMemory);
+
+                bool same = ranOriginal && ranRelocated && expected.nzcv == actual.nzcv &&
+                            memcmp(expectedMemory, actualMemory, sizeof(expectedMemory)) == 0;
+                int differing = -1;
+                for (int i = 0; i < 16 && same; i++) {
+                    if (expected.x[i] != actual.x[i]) differing = i, same = false;
+                }
+                if (same) continue;
+
+                failures++;
+                if (reported) continue;
+                reported = true;
+                fprintf(stderr, "FAIL %s/%s (x0=%#llx nzcv=%#llx)", c.name, placement.name,
+                        static_cast<unsigned long long>(x0), static_cast<unsigned long long>(nzcv));
+                if (!ranOriginal || !ranRelocated)
+                    fprintf(stderr, ": %s run did not finish\n", ranOriginal ? "relocated" : "original");
+                else if (differing >= 0)
+                    fprintf(stderr, ": x%d is %#llx, expected %#llx\n", differing,
+                            static_cast<unsigned long long>(actual.x[differing]),
+                            static_cast<unsigned long long>(expected.x[differing]));
+                else
+                    fprintf(stderr, ": flags or memory differ\n");
+                dumpCode("original", window, count);
+                dumpCode("relocated", outrw, size / sizeof(uint32_t));
+            }
+        }
+    }
+    return failures;
+}
+
+int main() {
+    // keep both the area and its mid destination 4MiB apart: out of B.cond/CBZ/ADR/LDR-literal range, within B range
+    auto area = static_cast<uint8_t*>(mapCode(nullptr, NEAR_SPAN));
+    if (area == nullptr) {
+        perror("mmap");
+        return 1;
+    }
+    // and another destination as far as the address space allows, beyond B range
+    auto far = static_cast<uint8_t*>(mapCode(area + 0x200000000ull, FAR_SIZE));
+    if (far == nullptr) {
+        perror("mmap");
+        return 1;
+    }
+    uintptr_t distance = far > area ? far - area : area - far;
+
+#if !defined(__aarch64__)
+    s_Emu.addRegion(reinterpret_cast<uintptr_t>(area), NEAR_SPAN);
+    s_Emu.addRegion(reinterpret_cast<uintptr_t>(far), FAR_SIZE);
+    s_Emu.addRegion(reinterpret_cast<uintptr_t>(s_Memory), sizeof(s_Memory));
+#endif
+
+    std::vector<Placement> placements = {
+        {"near", reinterpret_cast<uint32_t*>(area + 0x4000)},
+        {"near+4", reinterpret_cast<uint32_t*>(area + 0x4104)},
+        {"mid", reinterpret_cast<uint32_t*>(area + MID_OFFSET)},
+        {"mid+4", reinterpret_cast<uint32_t*>(area + MID_OFFSET + 0x104)},
+    };
+    if (distance >= 0x10000000) {
+        placements.push_back({"far", reinterpret_cast<uint32_t*>(far)});
+        placements.push_back({"far+4", reinterpret_cast<uint32_t*>(far + 0x104)});
+    } else {
+        printf("no mapping beyond B range could be placed, far placements are skipped\n");
+    }
+
+    int failures = 0;
+    for (auto& c : cases::all()) failures += runCase(c, area, placements.data(), placements.size());
+
+#if defined(__aarch64__)
+    const char* mode = "natively";
+#else
+    const char* mode = "through A64Emu";
+#endif
+    printf("relocator_test: %zu cases at %zu placements %s, %d failures\n", cases::all().size(), placements.size(),
+           mode, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+// Test of the sampling profiler's core on the host: a stand-in ThreadContextSource serves threads whose stacks are
+// built in host memory, and the folded stacks and module summaries the sampler reports are compared with what those
+// stacks should give
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "skyline/utils/Sampler.hpp"
+
+using skyline::utils::SampledContext;
+using skyline::utils::SampledModule;
+using skyline::utils::Sampler;
+using skyline::utils::ThreadContextSource;
+
+// module addresses are never dereferenced, only the stacks are real memory
+static constexpr uintptr_t MAIN = 0x8000000;
+static constexpr uintptr_t SDK = 0x9000000;
+static constexpr size_t MODULE_SIZE = 0x100000;
+
+// a thread stopped in a fixed place: its stack is a host buffer, with frame records pushed from the top down
+struct FakeThread {
+    std::string name;
+    std::vector<u64> stack = std::vector<u64>(0x100);
+    SampledContext context = {};
+    bool running = false;  // suspend fails, as for a thread running on another core
+
+    uintptr_t start() const { return reinterpret_cast<uintptr_t>(stack.data()); }
+    uintptr_t end() const { return start() + stack.size() * sizeof(u64); }
+
+    // stops the thread at pc, called through callers (outermost first). each caller gets a frame record
+    void stopAt(uintptr_t pc, const std::vector<uintptr_t>& callers) {
+        size_t slot = stack.size();
+        uintptr_t fp = 0;
+        for (uintptr_t ret : callers) {
+            slot -= 4;  // a frame record and some locals per frame
+            stack[slot] = fp;
+            stack[slot + 1] = ret + 4;
+            fp = start() + slot * sizeof(u64);
+        }
+        context = {pc, 0, fp, start() + (slot - 2) * sizeof(u64), end()};
+    }
+};
+
+class FakeSource : public ThreadContextSource {
+   public:
+    std::map<u64, FakeThread> threads;
+    int suspended = 0;
+
+    size_t listThreads(u64* ids, size_t max) override {
+        size_t count = 0;
+        for (auto& [id, thread] : threads) {
+            if (count < max) ids[count++] = id;
+        }
+        return count;
+    }
+
+    std::string threadName(u64 id) override { return threads[id].name; }
+
+    bool suspend(u64 id, SampledContext* context) override {
+        if (threads[id].running) return false;
+        suspended++;
+        *context = threads[id].context;
+        return true;
+    }
+
+    void resume(u64) override { suspended--; }
+
+    bool readStack(u64 id, uintptr_t address, u64* value) override {
+        FakeThread& thread = threads[id];
+        if (address < thread.start() || address + sizeof(u64) > thread.end()) return false;
+        *value = *reinterpret_cast<const u64*>(address);
+        return true;
+    }
+};
+
+// functions of the main module, 0x100 bytes each. sdk addresses stay unnamed
+static bool symbolize(uintptr_t address, const SampledModule& module, std::string* out) {
+    if (module.name != "main") return false;
+    static const char* s_Names[] = {"nnMain", "Game::Update", "Physics::Step", "std::sort<a;b>"};
+    size_t index = (address - module.start) / 0x100;
+    if (index >= sizeof(s_Names) / sizeof(s_Names[0])) return false;
+    *out = s_Names[index];
+    return true;
+}
+
+static int s_Failures = 0;
+
+static void expectLines(const char* test, const std::vector<std::string>& actual,
+                        const std::vector<std::string>& expected) {
+    if (actual == expected) return;
+    s_Failures++;
+    fprintf(stderr, "FAIL %s\n  expected:\n", test);
+    for (auto& line : expected) fprintf(stderr, "    %s\n", line.c_str());
+    fprintf(stderr, "  reported:\n");
+    for (auto& line : actual) fprintf(stderr, "    %s\n", line.c_str());
+}
+
+static void expect(const char* test, bool condition, const char* what) {
+    if (condition) return;
+    s_Failures++;
+    fprintf(stderr, "FAIL %s: %s\n", test, what);
+}
+
+static std::vector<std::string> report(Sampler& sampler) {
+    std::vector<std::string> lines;
+    sampler.report([&](const std::string& line) { lines.push_back(line); });
+    return lines;
+}
+
+static Sampler makeSampler(FakeSource* source) {
+    Sampler sampler(source, symbolize);
+    sampler.setModules({{"sdk", SDK, SDK + MODULE_SIZE}, {"main", MAIN, MAIN + MODULE_SIZE}});
+    return sampler;
+}
+
+// a stack is folded root first, every frame symbolized, return addresses attributed to the call
+static void testWalk() {
+    FakeSource source;
+    source.threads[1].name = "Main";
+    source.threads[1].stopAt(MAIN + 0x208, {MAIN + 0x10, MAIN + 0x140});
+
+    Sampler sampler = makeSampler(&source);
+    sampler.sample();
+    expectLines("walk", report(sampler),
+                {"# Main: 1 samples, main 1 (100.0%)", "Main;main!nnMain;main!Game::Update;main!Physics::Step 1"});
+    expect("walk", source.suspended == 0, "every suspend is resumed");
+}
+
+// samples at different addresses of the same functions fold into one line, per-module counts follow the leaf
+static void testAggregation() {
+    FakeSource source;
+    FakeThread& thread = source.threads[7];
+    thread.name = "Worker thread";
+
+    Sampler sampler = makeSampler(&source);
+    thread.stopAt(MAIN + 0x204, {MAIN + 0x10, MAIN + 0x140});
+    sampler.sample();
+    thread.stopAt(MAIN + 0x2f0, {MAIN + 0x10, MAIN + 0x140});
+    sampler.sample();
+    thread.stopAt(SDK + 0x1230, {MAIN + 0x10, MAIN + 0x100});
+    sampler.sample();
+    thread.stopAt(MAIN + 0x110, {MAIN + 0x10});
+    sampler.sample();
+
+    expectLines("aggregation", report(sampler),
+                {"# Worker_thread: 4 samples, main 3 (75.0%), sdk 1 (25.0%)",
+                 "Worker_thread;main!nnMain;main!Game::Update 1",
+                 "Worker_thread;main!nnMain;main!Game::Update;main!Physics::Step 2",
+                 "Worker_thread;main!nnMain;main!Game::Update;sdk+0x1230 1"});
+
+    // a report starts over
+    expectLines("aggregation", report(sampler), {});
+}
+
+// names that aren't in the symbolizer fall back to module+offset, or the bare address outside of any module. ';'
+// can't appear in a folded frame, and threads without a name go by their id
+static void testSymbolization() {
+    FakeSource source;
+    source.threads[0x42].stopAt(0x1234, {MAIN + 0x300, MAIN + 0x1000});
+
+    Sampler sampler = makeSampler(&source);
+    sampler.sample();
+    expectLines("symbolization", report(sampler),
+                {"# 66: 1 samples, unknown 1 (100.0%)", "66;main!std::sort<a:b>;main+0x1000;0x1234 1"});
+}
+
+// an fp outside of the live stack isn't followed: below sp, past the end, or misaligned. the sample keeps its pc
+static void testBounds() {
+    FakeSource source;
+    FakeThread& thread = source.threads[1];
+    thread.name = "Main";
+    thread.stopAt(MAIN + 0x208, {MAIN + 0x10, MAIN + 0x140});
+    uintptr_t records = thread.context.fp;
+
+    Sampler sampler = makeSampler(&source);
+    const uintptr_t bogus[] = {thread.context.sp - 0x10, thread.end(), thread.end() - 8, records + 4, 0x1234560};
+    for (uintptr_t fp : bogus) {
+        thread.context.fp = fp;
+        sampler.sample();
+    }
+    expectLines("bounds", report(sampler), {"# Main: 5 samples, main 5 (100.0%)", "Main;main!Physics::Step 5"});
+
+    // a record pointing back down the stack ends the walk after its own frame
+    thread.context.fp = records;
+    thread.stack[(records - thread.start()) / sizeof(u64)] = thread.context.sp;
+    sampler.sample();
+    expectLines("bounds", report(sampler),
+                {"# Main: 1 samples, main 1 (100.0%)", "Main;main!Game::Update;main!Physics::Step 1"});
+}
+
+// threads that can't be suspended are skipped, without a resume
+static void testSuspendFailure() {
+    FakeSource source;
+    source.threads[1].name = "Main";
+    source.threads[1].stopAt(MAIN + 0x10, {});
+    source.threads[2].name = "Busy";
+    source.threads[2].running = true;
+
+    Sampler sampler = makeSampler(&source);
+    sampler.sample();
+    sampler.sample();
+    expectLines("suspend failure", report(sampler), {"# Main: 2 samples, main 2 (100.0%)", "Main;main!nnMain 2"});
+    expect("suspend failure", source.suspended == 0, "every suspend is resumed, and nothing else");
+}
+
+// the walk is bounded, however deep the stack
+static void testDepth() {
+    FakeSource source;
+    std::vector<uintptr_t> callers(Sampler::MAX_FRAMES + 8, MAIN + 0x100);
+    source.threads[1].stopAt(MAIN + 0x200, callers);
+
+    Sampler sampler = makeSampler(&source);
+    sampler.sample();
+    auto lines = report(sampler);
+    size_t frames = lines.size() == 2 ? std::count(lines[1].begin(), lines[1].end(), ';') : 0;
+    expect("depth", frames == Sampler::MAX_FRAMES, "the stack is cut at MAX_FRAMES");
+}
+
+int main() {
+    testWalk();
+    testAggregation();
+    testSymbolization();
+    testBounds();
+    testSuspendFailure();
+    testDepth();
+
+    printf("sampler_test: %d failures\n", s_Failures);
+    return s_Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+/**
+ * @file alloc.h
+ * @brief Stand-in for skyline's allocation functions on Linux hosts, which has them all in its libc.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C++" {
+#endif
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+}
+#endif
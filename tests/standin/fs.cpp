@@ -0,0 +1,90 @@
+// Linux stand-ins for the nn::fs calls the symbol map loader makes, on plain files. Paths are used as they are, so a
+// test points g_RomMountStr at a directory of its own
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "nn/fs.h"
+
+extern "C" {
+#include "skyline/nx/result.h"
+#include "skyline/utils/utils.h"
+}
+
+namespace {
+
+// an open directory is listed in full right away
+struct Directory {
+    std::vector<nn::fs::DirectoryEntry> entries;
+};
+
+Result notFound() { return MAKERESULT(Module_Libnx, LibnxError_NotFound); }
+
+}  // namespace
+
+namespace nn::fs {
+
+Result OpenFile(FileHandle* handle, char const* path, s32) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return notFound();
+    handle->handle = reinterpret_cast<void*>(static_cast<intptr_t>(fd));
+    return 0;
+}
+
+Result ReadFile(FileHandle handle, s64 offset, void* buffer, u64 size) {
+    int fd = static_cast<int>(reinterpret_cast<intptr_t>(handle.handle));
+    for (u64 read = 0; read < size;) {
+        ssize_t count = pread(fd, static_cast<u8*>(buffer) + read, size - read, offset + read);
+        if (count <= 0) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+        read += count;
+    }
+    return 0;
+}
+
+void CloseFile(FileHandle handle) { close(static_cast<int>(reinterpret_cast<intptr_t>(handle.handle))); }
+
+Result OpenDirectory(DirectoryHandle* handle, char const* path, s32 mode) {
+    DIR* dir = opendir(path);
+    if (dir == nullptr) return notFound();
+
+    auto directory = new Directory;
+    while (dirent* entry = readdir(dir)) {
+        struct stat info;
+        std::string entryPath = std::string(path) + "/" + entry->d_name;
+        if (entry->d_name[0] == '.' || stat(entryPath.c_str(), &info) != 0) continue;
+
+        bool isFile = S_ISREG(info.st_mode);
+        if (!(mode & (isFile ? OpenDirectoryMode_File : OpenDirectoryMode_Directory))) continue;
+
+        DirectoryEntry out = {};
+        strncpy(out.name, entry->d_name, sizeof(out.name) - 1);
+        out.type = isFile ? DirectoryEntryType_File : DirectoryEntryType_Directory;
+        out.fileSize = isFile ? info.st_size : 0;
+        directory->entries.push_back(out);
+    }
+    closedir(dir);
+
+    handle->handle = directory;
+    return 0;
+}
+
+Result GetDirectoryEntryCount(s64* count, DirectoryHandle handle) {
+    *count = static_cast<Directory*>(handle.handle)->entries.size();
+    return 0;
+}
+
+Result ReadDirectory(s64* count, DirectoryEntry* entries, DirectoryHandle handle, s64 max) {
+    auto& all = static_cast<Directory*>(handle.handle)->entries;
+    *count = MIN(max, static_cast<s64>(all.size()));
+    memcpy(entries, all.data(), *count * sizeof(DirectoryEntry));
+    return 0;
+}
+
+void CloseDirectory(DirectoryHandle handle) { delete static_cast<Directory*>(handle.handle); }
+
+};  // namespace nn::fs
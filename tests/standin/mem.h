@@ -0,0 +1,16 @@
+/**
+ * @file mem.h
+ * @brief Stand-in for skyline's memory functions on Linux hosts, which has them all in its libc.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C++" {
+#endif
+
+#include <malloc.h>
+#include <string.h>
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,261 @@
+// Linux stand-ins for the console's code memory: Jit, ControlledPages and the address space queries the hook paths
+// make. They behave like JitType_CodeMemory, the type a 5.0.0+ console ends up with. A region's code lives in a memfd,
+// so its rx pages and any rw alias of them are views of the same memory, like svcMapProcessMemory provides. Making a
+// region executable revokes access to its original rw buffer, as svcMapProcessCodeMemory does, so writing through a
+// stale pointer faults here as well
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#include "skyline/inlinehook/controlledpages.hpp"
+#include "skyline/inlinehook/installstats.hpp"
+
+extern "C" {
+#include "skyline/nx/kernel/jit.h"
+#include "skyline/nx/kernel/svc.h"
+#include "skyline/utils/utils.h"
+}
+
+namespace {
+
+// the code regions of every Jit, by the start of their rx pages
+struct CodeRegion {
+    size_t size;
+    int fd;
+};
+std::map<uintptr_t, CodeRegion> s_CodeRegions;
+
+// user space ends here on x86-64 and AArch64 Linux alike
+constexpr uintptr_t ADDRESS_SPACE_END = 1ull << 47;
+
+const CodeRegion* findCodeRegion(uintptr_t address, uintptr_t* start) {
+    auto it = s_CodeRegions.upper_bound(address);
+    if (it == s_CodeRegions.begin()) return nullptr;
+    it--;
+    if (address >= it->first + it->second.size) return nullptr;
+    *start = it->first;
+    return &it->second;
+}
+
+// maps a new rw view of the code region holding [rx, rx + size), returning the view of rx or nullptr
+void* mapAlias(uintptr_t rx, size_t size) {
+    uintptr_t start;
+    const CodeRegion* region = findCodeRegion(rx, &start);
+    if (region == nullptr || rx + size > start + region->size) return nullptr;
+
+    uintptr_t page = ALIGN_DOWN(rx, PAGE_SIZE);
+    size_t length = ALIGN_UP(rx + size - page, PAGE_SIZE);
+    void* view = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, region->fd, page - start);
+    if (view == MAP_FAILED) return nullptr;
+    return static_cast<uint8_t*>(view) + (rx - page);
+}
+
+// the pages holding [address, address + size)
+void* pageStart(void* address) {
+    return reinterpret_cast<void*>(ALIGN_DOWN(reinterpret_cast<uintptr_t>(address), PAGE_SIZE));
+}
+
+size_t pageLength(void* address, size_t size) {
+    uintptr_t page = ALIGN_DOWN(reinterpret_cast<uintptr_t>(address), PAGE_SIZE);
+    return ALIGN_UP(reinterpret_cast<uintptr_t>(address) + size - page, PAGE_SIZE);
+}
+
+void unmapAlias(void* rw, uintptr_t rx, size_t size) {
+    uintptr_t page = ALIGN_DOWN(rx, PAGE_SIZE);
+    munmap(reinterpret_cast<void*>(ALIGN_DOWN(reinterpret_cast<uintptr_t>(rw), PAGE_SIZE)),
+           ALIGN_UP(rx + size - page, PAGE_SIZE));
+}
+
+}  // namespace
+
+//-------------------------------------------------------------------------
+
+// reads the block around addr out of /proc/self/maps: a mapping, or the gap between two of them
+Result svcQueryMemory(MemoryInfo* meminfo_ptr, u32* pageinfo, u64 addr) {
+    FILE* maps = fopen("/proc/self/maps", "r");
+    if (maps == nullptr) return MAKERESULT(Module_Libnx, LibnxError_BadQueryMemory);
+
+    *meminfo_ptr = {};
+    *pageinfo = 0;
+    u64 gapStart = 0, start, end;
+    char perms[5];
+    bool found = false;
+    while (fscanf(maps, "%lx-%lx %4s%*[^\n]", &start, &end, perms) == 3) {
+        if (addr < start) {
+            *meminfo_ptr = {gapStart, start - gapStart, MemType_Unmapped};
+            found = true;
+            break;
+        }
+        if (addr < end) {
+            u32 perm = (perms[0] == 'r' ? Perm_R : 0) | (perms[1] == 'w' ? Perm_W : 0);
+            if (perms[2] == 'x') perm |= Perm_X;
+            uintptr_t region;
+            u32 type = findCodeRegion(addr, &region) != nullptr ? MemType_ModuleCodeStatic : MemType_Normal;
+            *meminfo_ptr = {start, end - start, type, 0, perm};
+            found = true;
+            break;
+        }
+        gapStart = end;
+    }
+    fclose(maps);
+
+    // past the last mapping: free up to the end of user space, then nothing but the wraparound
+    if (!found && addr < ADDRESS_SPACE_END) *meminfo_ptr = {gapStart, ADDRESS_SPACE_END - gapStart, MemType_Unmapped};
+    if (!found && addr >= ADDRESS_SPACE_END)
+        *meminfo_ptr = {ADDRESS_SPACE_END, 0 - ADDRESS_SPACE_END, MemType_Reserved};
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+
+Result jitCreate(Jit* j, void* rx_addr, size_t size) {
+    size = ALIGN_UP(size, PAGE_SIZE);
+
+    int fd = memfd_create("skyline-jit", MFD_CLOEXEC);
+    if (fd < 0) return MAKERESULT(Module_Libnx, LibnxError_JitUnavailable);
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return MAKERESULT(Module_Libnx, LibnxError_OutOfMemory);
+    }
+
+    // the rx pages are reserved right away, like virtmemReserve does
+    int fixed = rx_addr != nullptr ? MAP_FIXED_NOREPLACE : 0;
+    void* rx = mmap(rx_addr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | fixed, -1, 0);
+    void* src = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (rx == MAP_FAILED || src == MAP_FAILED || (rx_addr != nullptr && rx != rx_addr)) {
+        if (rx != MAP_FAILED) munmap(rx, size);
+        if (src != MAP_FAILED) munmap(src, size);
+        close(fd);
+        return MAKERESULT(Module_Libnx, LibnxError_OutOfMemory);
+    }
+
+    j->type = JitType_CodeMemory;
+    j->size = size;
+    j->src_addr = src;
+    j->rx_addr = rx;
+    j->rw_addr = src;
+    j->is_executable = false;
+    j->handle = fd;
+    s_CodeRegions[reinterpret_cast<uintptr_t>(rx)] = {size, fd};
+    return 0;
+}
+
+Result jitTransitionToWritable(Jit* j) {
+    if (!j->is_executable) return 0;
+
+    mmap(j->rx_addr, j->size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    mprotect(j->src_addr, j->size, PROT_READ | PROT_WRITE);
+    j->is_executable = false;
+    return 0;
+}
+
+Result jitTransitionToExecutable(Jit* j) {
+    if (j->is_executable) return 0;
+
+    void* rx = mmap(j->rx_addr, j->size, PROT_READ | PROT_EXEC, MAP_SHARED | MAP_FIXED, j->handle, 0);
+    if (rx == MAP_FAILED) return MAKERESULT(Module_Libnx, LibnxError_JitUnavailable);
+    mprotect(j->src_addr, j->size, PROT_NONE);
+    j->is_executable = true;
+    return 0;
+}
+
+Result jitClose(Jit* j) {
+    jitTransitionToWritable(j);
+    s_CodeRegions.erase(reinterpret_cast<uintptr_t>(j->rx_addr));
+    munmap(j->rx_addr, j->size);
+    munmap(j->src_addr, j->size);
+    close(j->handle);
+    return 0;
+}
+
+void* jitGetRwAddr(Jit* j) { return j->rw_addr; }
+
+void* jitGetRxAddr(Jit* j) { return j->rx_addr; }
+
+//-------------------------------------------------------------------------
+
+namespace skyline::inlinehook {
+
+Result locateMappableSpaceNear(uintptr_t* out_address, size_t size, uintptr_t near, size_t range) {
+    uintptr_t lo = MAX(near > range ? near - range : 0, 0x10000);
+    uintptr_t hi = MIN(near + range, ADDRESS_SPACE_END);
+
+    uintptr_t best = 0;
+    uintptr_t best_distance = UINTPTR_MAX;
+
+    MemoryInfo mem_info = {};
+    u32 page_info = 0;
+    for (uintptr_t cur = lo; cur < hi; cur = mem_info.addr + mem_info.size) {
+        R_TRY(svcQueryMemory(&mem_info, &page_info, cur));
+        if (mem_info.addr + mem_info.size <= cur) break;
+        if (mem_info.type != MemType_Unmapped) continue;
+
+        uintptr_t start = MAX(mem_info.addr, lo);
+        uintptr_t end = MIN(mem_info.addr + mem_info.size, hi);
+        uintptr_t candidate = end <= near ? ALIGN_DOWN(end - size, PAGE_SIZE) : ALIGN_UP(start, PAGE_SIZE);
+        if (end - start < size || candidate < start || candidate + size > end) continue;
+
+        uintptr_t distance = candidate < near ? near - candidate : candidate + size - near;
+        if (distance < best_distance) {
+            best = candidate;
+            best_distance = distance;
+        }
+    }
+
+    R_UNLESS(best != 0, KERNELRESULT(OutOfMemory));
+    *out_address = best;
+    return 0;
+}
+
+Result mapPersistentAlias(uintptr_t rx, size_t size, uintptr_t* out_rw) {
+    InstallTimer timer(InstallPhase_Claim);
+
+    void* rw = mapAlias(rx, size);
+    R_UNLESS(rw != nullptr, KERNELRESULT(OutOfMemory));
+    *out_rw = reinterpret_cast<uintptr_t>(rw);
+    return 0;
+}
+
+// code of a stand-in Jit is patched through an rw view, like on console. the program's own code, which only an
+// AArch64 build patches, is made writable in place for the duration of the claim
+ControlledPages::ControlledPages(void* rx, size_t size) {
+    this->rx = rx;
+    this->size = size;
+    rw = nullptr;
+    isClaimed = false;
+    isCached = false;
+}
+
+void ControlledPages::claim() {
+    if (isClaimed) return;
+
+    InstallTimer timer(InstallPhase_Claim);
+    uintptr_t region;
+    if (findCodeRegion(reinterpret_cast<uintptr_t>(rx), &region) != nullptr) {
+        rw = mapAlias(reinterpret_cast<uintptr_t>(rx), size);
+    } else if (mprotect(pageStart(rx), pageLength(rx, size), PROT_READ | PROT_WRITE | PROT_EXEC) == 0) {
+        rw = rx;
+    }
+    if (rw == nullptr) {
+        fprintf(stderr, "ControlledPages: can't write to %p\n", rx);
+        abort();
+    }
+    isClaimed = true;
+}
+
+void ControlledPages::unclaim() {
+    if (!isClaimed) return;
+
+    InstallTimer timer(InstallPhase_Claim);
+    if (rw != rx)
+        unmapAlias(rw, reinterpret_cast<uintptr_t>(rx), size);
+    else
+        mprotect(pageStart(rx), pageLength(rx, size), PROT_READ | PROT_EXEC);
+    rw = nullptr;
+    isClaimed = false;
+}
+
+};  // namespace skyline::inlinehook
@@ -0,0 +1,217 @@
+// Linux stand-ins for the rest of what the hook paths call into: nn::os mutexes and threads on pthreads, the logger
+// on stdout, and no-ops for the cache maintenance and the subsystems the host builds leave out
+#include <time.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "nn/os.hpp"
+#include "skyline/inlinehook/deferred.hpp"
+#include "skyline/inlinehook/probes.hpp"
+#include "skyline/inlinehook/tracing.hpp"
+#include "skyline/logger/Logger.hpp"
+
+extern "C" {
+#include "skyline/nx/arm/cache.h"
+}
+
+//-------------------------------------------------------------------------
+
+// a MutexType is too small to hold a pthread mutex, so each one gets a recursive mutex on the side
+static std::mutex s_MutexesLock;
+static std::map<const nn::os::MutexType*, std::recursive_mutex> s_Mutexes;
+
+static std::recursive_mutex& mutexOf(const nn::os::MutexType* mutex) {
+    std::lock_guard<std::mutex> lock(s_MutexesLock);
+    return s_Mutexes[mutex];
+}
+
+namespace nn::os {
+
+void InitializeMutex(MutexType* mutex, bool, s32) { mutexOf(mutex); }
+void FinalizeMutex(MutexType*) {}
+void LockMutex(MutexType* mutex) { mutexOf(mutex).lock(); }
+bool TryLockMutex(MutexType* mutex) { return mutexOf(mutex).try_lock(); }
+void UnlockMutex(MutexType* mutex) { mutexOf(mutex).unlock(); }
+
+// the entry point and argument wait in the ThreadType until the thread is started. started threads are kept on the
+// side until they are waited for, and never destroyed with the table: some run until the process exits
+static std::mutex s_ThreadsLock;
+static auto& s_Threads = *new std::map<const ThreadType*, std::thread>;
+static thread_local ThreadType* s_CurrentThread = nullptr;
+
+Result CreateThread(ThreadType* thread, void (*entry)(void*), void* arg, void*, u64, s32, s32) {
+    thread->ThreadFunc = reinterpret_cast<u64>(entry);
+    thread->Arg = arg;
+    return 0;
+}
+
+void StartThread(ThreadType* thread) {
+    std::lock_guard<std::mutex> lock(s_ThreadsLock);
+    s_Threads[thread] = std::thread([thread]() {
+        s_CurrentThread = thread;
+        reinterpret_cast<void (*)(void*)>(thread->ThreadFunc)(thread->Arg);
+    });
+}
+
+void WaitThread(ThreadType* thread) {
+    std::thread running;
+    {
+        std::lock_guard<std::mutex> lock(s_ThreadsLock);
+        running = std::move(s_Threads[thread]);
+        s_Threads.erase(thread);
+    }
+    if (running.joinable()) running.join();
+}
+
+void DestroyThread(ThreadType*) {}
+
+// threads not started through StartThread get a ThreadType of their own on first use
+ThreadType* GetCurrentThread() {
+    static thread_local ThreadType s_Unnamed;
+    return s_CurrentThread != nullptr ? s_CurrentThread : &s_Unnamed;
+}
+
+void YieldThread() { std::this_thread::yield(); }
+
+void SleepThread(nn::TimeSpan time) {
+    struct timespec duration = {static_cast<time_t>(time.nanoseconds / 1000000000),
+                                static_cast<long>(time.nanoseconds % 1000000000)};
+    nanosleep(&duration, nullptr);
+}
+
+// events are too small for a condition variable as well
+struct EventState {
+    std::mutex lock;
+    std::condition_variable signaled;
+    bool isSignaled;
+    bool autoClear;
+};
+
+static std::mutex s_EventsLock;
+static std::map<const EventType*, EventState> s_Events;
+
+static EventState& eventOf(const EventType* event) {
+    std::lock_guard<std::mutex> lock(s_EventsLock);
+    return s_Events[event];
+}
+
+void InitializeEvent(EventType* event, bool initiallySignaled, EventClearMode clearMode) {
+    EventState& state = eventOf(event);
+    state.isSignaled = initiallySignaled;
+    state.autoClear = clearMode == EventClearMode_AutoClear;
+}
+
+void SignalEvent(EventType* event) {
+    EventState& state = eventOf(event);
+    std::lock_guard<std::mutex> lock(state.lock);
+    state.isSignaled = true;
+    state.signaled.notify_all();
+}
+
+void WaitEvent(EventType* event) {
+    EventState& state = eventOf(event);
+    std::unique_lock<std::mutex> lock(state.lock);
+    state.signaled.wait(lock, [&state]() { return state.isSignaled; });
+    if (state.autoClear) state.isSignaled = false;
+}
+
+};  // namespace nn::os
+
+//-------------------------------------------------------------------------
+
+// nothing to do on other hosts, which never execute the code
+void armDCacheFlush(void*, size_t) {}
+void armICacheInvalidate(void* address, size_t size) {
+    __builtin___clear_cache(static_cast<char*>(address), static_cast<char*>(address) + size);
+}
+
+#ifdef __aarch64__
+
+// an AArch64 build links the real handlers of armutils.s, whose time probes are never installed here
+extern "C" uintptr_t skyline_time_probe_enter(const void*, uintptr_t) { abort(); }
+extern "C" uintptr_t skyline_time_probe_exit() { abort(); }
+
+#else
+
+// the handlers are never entered on other hosts, inline hook entries only copy their first bytes
+asm(R"(
+    .section .rodata
+    .p2align 4
+    .global inlineHandlerStart, inlineHandlerEnd, inlineHandlerImpl, inlineHandlerMinimalImpl, inlineHandlerFpImpl
+    .global timeProbeEnter, timeProbeExit
+inlineHandlerStart:
+inlineHandlerImpl:
+inlineHandlerMinimalImpl:
+inlineHandlerFpImpl:
+timeProbeEnter:
+timeProbeExit:
+    .fill 16, 4, 0xd503201f
+inlineHandlerEnd:
+    .text
+)");
+
+#endif
+
+//-------------------------------------------------------------------------
+
+namespace skyline::inlinehook {
+
+// no nn::ro on the host, so hooks are never deferred
+bool DeferredHooks::setEnabled(HookHandle, bool) { return false; }
+bool DeferredHooks::cancel(HookHandle) { return false; }
+
+// time and trace probes need the console's TLS, they fail to install on the host
+Result TimeProbes::initialize() { return MAKERESULT(Module_Libnx, LibnxError_NotInitialized); }
+Result TraceRings::initialize() { return MAKERESULT(Module_Libnx, LibnxError_NotInitialized); }
+Result TraceRings::registerName(const char*, u32*) { return MAKERESULT(Module_Libnx, LibnxError_NotInitialized); }
+
+};  // namespace skyline::inlinehook
+
+//-------------------------------------------------------------------------
+
+namespace skyline::logger {
+
+// the hook paths log every hook they install or remove. those lines are formatted like on console, so they cost the
+// same, but dropped: thousands of them would bury a benchmark's results
+class StdoutLogger : public Logger {
+   public:
+    void Initialize() override {}
+    void SendRaw(void* data, size_t size) override { fwrite(data, 1, size, stdout); }
+    std::string FriendlyName() override { return "stdout"; }
+    bool ShouldFlush() override { return true; }
+};
+
+static StdoutLogger s_Stdout;
+Logger* s_Instance = &s_Stdout;
+
+static bool isPerHookLine(const char* line) {
+    static const char* s_Prefixes[] = {"[And64InlineHook] inline hook ", "[And64InlineHook] 0x",
+                                       "[And64InlineHook] removed hook on ", "[And64InlineHook] batch installed "};
+    for (const char* prefix : s_Prefixes) {
+        if (strncmp(line, prefix, strlen(prefix)) == 0) return true;
+    }
+    return false;
+}
+
+void Logger::LogFormat(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    char line[0x400];
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (!isPerHookLine(line)) printf("%s\n", line);
+}
+
+void Logger::Log(const char* data, size_t size) {
+    printf("%.*s", static_cast<int>(strnlen(data, size)), data);
+}
+
+};  // namespace skyline::logger
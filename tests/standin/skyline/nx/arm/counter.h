@@ -0,0 +1,20 @@
+/**
+ * @file counter.h
+ * @brief Stand-in for the AArch64 system counter on Linux hosts, ticking at the console's 19.2MHz.
+ */
+#pragma once
+#include <time.h>
+
+#include "types.h"
+
+static inline u64 armNsToTicks(u64 ns) { return (ns * 12) / 625; }
+
+static inline u64 armTicksToNs(u64 tick) { return (tick * 625) / 12; }
+
+static inline u64 armGetSystemTick(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return armNsToTicks(now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+
+static inline u64 armGetSystemTickFreq(void) { return 19200000; }
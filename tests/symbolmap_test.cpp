@@ -0,0 +1,142 @@
+// Round trip of the symbol maps through SymbolMap on the host. convertSymbolMap.py writes one large generated map as
+// v3 and another as v2, SymbolMap loads both through the stand-in nn::fs the way it loads them from romfs, and then
+// every name has to resolve to its address, absent names have to miss, and addresses have to symbolize back
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "skyline/utils/SymbolMap.hpp"
+#include "skyline/utils/cpputils.hpp"
+
+namespace skyline::utils {
+std::string g_RomMountStr;
+u64 g_MainTextAddr = 0x80000000;
+u64 g_MainRodataAddr = 0xa0000000;
+};  // namespace skyline::utils
+
+using namespace skyline::utils;
+
+static constexpr auto MAP_DIR = "skyline/maps/3AB632DEE82D59448599B2291F30994A";
+
+struct GeneratedSymbol {
+    std::string name;
+    u32 offset;
+};
+
+// mangled-looking names of random length, unique through their index. offsets are 0x10 apart, from base on
+static std::vector<GeneratedSymbol> generate(const char* tag, size_t count, u32 base) {
+    static const char s_Alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    u64 state = 0x9e3779b97f4a7c15 ^ base;
+    auto next = [&state]() { return (state = state * 6364136223846793005 + 1442695040888963407) >> 33; };
+
+    std::vector<GeneratedSymbol> symbols(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string name = "_ZN" + std::string(tag);
+        for (size_t length = next() % 48 + 1; length != 0; length--) name += s_Alphabet[next() % 62];
+        symbols[i] = {name + std::to_string(i) + "Ev", static_cast<u32>(base + i * 0x10)};
+    }
+    return symbols;
+}
+
+// writes the symbols as an IDA .map and converts it with the script
+static bool writeMap(const std::string& dir, const char* name, const char* version,
+                     const std::vector<GeneratedSymbol>& symbols) {
+    std::string source = dir + "/" + name + ".map";
+    FILE* f = fopen(source.c_str(), "w");
+    if (f == nullptr) return false;
+    fprintf(f, " 0001:00000000 08000000H .text CODE\n\n  Address         Publics by Value\n\n");
+    for (auto& symbol : symbols) fprintf(f, " 0001:%08X       %s\n", symbol.offset, symbol.name.c_str());
+    fclose(f);
+
+    std::string command = std::string("python3 ") + CONVERT_SYMBOL_MAP + " " + source + " " + dir + "/" + MAP_DIR +
+                          "/" + name + ".bin " + version + " > /dev/null";
+    return system(command.c_str()) == 0;
+}
+
+static int s_Failures = 0;
+
+static void expect(const char* test, bool condition, const std::string& what) {
+    if (condition) return;
+    // a broken reader fails most names, a few are enough to tell why
+    if (s_Failures++ < 10) fprintf(stderr, "FAIL %s: %s\n", test, what.c_str());
+}
+
+static void testLookup(const char* test, const std::vector<GeneratedSymbol>& symbols) {
+    for (size_t i = 0; i < symbols.size(); i++) {
+        auto& symbol = symbols[i];
+        expect(test, SymbolMap::getSymbolAddress(symbol.name) == g_MainTextAddr + symbol.offset, symbol.name);
+
+        // a view into a longer string only matches its own characters
+        if (i % 97 == 0) {
+            std::string longer = symbol.name + "Ev";
+            expect(test, SymbolMap::getSymbolAddress(std::string_view(longer).substr(0, symbol.name.size())) ==
+                             g_MainTextAddr + symbol.offset,
+                   symbol.name + " as a view");
+            expect(test, SymbolMap::getSymbolAddress(longer) == 0, longer + " is absent");
+        }
+    }
+}
+
+// absent names miss twice, the second time out of the miss cache
+static void testMisses(const std::vector<GeneratedSymbol>& absent, const std::vector<GeneratedSymbol>& present) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (auto& symbol : absent) expect("misses", SymbolMap::getSymbolAddress(symbol.name) == 0, symbol.name);
+        for (size_t i = 0; i < present.size(); i += 13) {
+            std::string prefix = present[i].name.substr(0, present[i].name.size() - 1);
+            expect("misses", SymbolMap::getSymbolAddress(prefix) == 0, prefix);
+        }
+    }
+    expect("misses", SymbolMap::getSymbolAddress("") == 0, "the empty name");
+}
+
+// a symbol covers the addresses up to the next one
+static void testSymbolize(const std::vector<GeneratedSymbol>& symbols) {
+    for (size_t i = 0; i < symbols.size(); i += 7) {
+        const char* name;
+        uintptr_t offset;
+        bool found = SymbolMap::symbolize(g_MainTextAddr + symbols[i].offset + 4, &name, &offset);
+        expect("symbolize", found && symbols[i].name == name && offset == 4, symbols[i].name);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 0) : 100000;
+
+    char root[] = "/tmp/symbolmap_testXXXXXX";
+    if (mkdtemp(root) == nullptr) return 1;
+    std::string dir = root;
+    std::string maps = dir + "/" + MAP_DIR;
+    if (system(("mkdir -p " + maps).c_str()) != 0) return 1;
+
+    auto v3 = generate("v3", count, 0);
+    auto v2 = generate("v2", count / 2, 0x4000000);
+    if (!writeMap(dir, "v3", "v3", v3) || !writeMap(dir, "v2", "v2", v2)) {
+        fprintf(stderr, "convertSymbolMap.py failed\n");
+        return 1;
+    }
+
+    // a map cut short after its header is skipped, without taking the others with it
+    FILE* truncated = fopen((maps + "/truncated.bin").c_str(), "wb");
+    FILE* whole = fopen((maps + "/v3.bin").c_str(), "rb");
+    char header[0x40];
+    fwrite(header, 1, fread(header, 1, sizeof(header), whole), truncated);
+    fclose(whole);
+    fclose(truncated);
+
+    g_RomMountStr = dir + "/";
+    expect("load", SymbolMap::tryLoad(), "the maps load");
+
+    testLookup("v3", v3);
+    testLookup("v2", v2);
+    testMisses(generate("absent", count / 4, 0), v3);
+    testSymbolize(v3);
+    testSymbolize(v2);
+
+    system(("rm -rf " + dir).c_str());
+
+    printf("symbolmap_test: %zu v3 and %zu v2 symbols, %d failures\n", v3.size(), v2.size(), s_Failures);
+    return s_Failures == 0 ? 0 : 1;
+}